@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+// Qt includes
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStandardItemModel>
+#include <QStyleOptionViewItem>
+#include <QTest>
+
+// QApt includes
+#include <QApt/Package>
+
+// Own includes
+#include "PackageModel/PackageDelegate.h"
+#include "PackageModel/PackageModel.h"
+
+class PackageDelegateTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void paintsStatusText_data();
+    void paintsStatusText();
+};
+
+// @returns whether anything at all got painted onto the transparent @p image
+static bool hasPaintedPixels(const QImage &image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void PackageDelegateTest::paintsStatusText_data()
+{
+    QTest::addColumn<int>("column");
+    QTest::addColumn<int>("role");
+    QTest::addColumn<int>("state");
+
+    QTest::newRow("installed") << 1 << int(PackageModel::StatusRole) << int(QApt::Package::Installed);
+    QTest::newRow("upgradeable") << 1 << int(PackageModel::StatusRole)
+                                 << int(QApt::Package::Installed | QApt::Package::Upgradeable);
+    QTest::newRow("broken") << 1 << int(PackageModel::StatusRole) << int(QApt::Package::NowBroken);
+    QTest::newRow("not installed") << 1 << int(PackageModel::StatusRole) << 0;
+    QTest::newRow("to install") << 2 << int(PackageModel::ActionRole) << int(QApt::Package::ToInstall);
+}
+
+void PackageDelegateTest::paintsStatusText()
+{
+    QFETCH(int, column);
+    QFETCH(int, role);
+    QFETCH(int, state);
+
+    QStandardItemModel model(1, 3);
+    const QModelIndex index = model.index(0, column);
+    model.setData(index, state, role);
+
+    QImage image(200, 40, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QStyleOptionViewItem option;
+    option.rect = image.rect();
+    option.font = QApplication::font();
+    option.fontMetrics = QFontMetrics(option.font);
+    option.palette = QApplication::palette();
+    option.state = QStyle::State_Enabled;
+    option.textElideMode = Qt::ElideRight;
+
+    PackageDelegate delegate;
+    QPainter painter(&image);
+    static_cast<QAbstractItemDelegate &>(delegate).paint(&painter, option, index);
+    painter.end();
+
+    QVERIFY(hasPaintedPixels(image));
+}
+
+QTEST_MAIN(PackageDelegateTest)
+
+#include "PackageDelegateTest.moc"
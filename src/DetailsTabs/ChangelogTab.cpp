@@ -21,25 +21,64 @@
 #include "ChangelogTab.h"
 
 // Qt includes
-#include <QDir>
-#include <QtCore/QTextStream>
-#include <QTemporaryFile>
+#include <QtConcurrentRun>
+#include <QtCore/QFile>
+#include <QtCore/QRegularExpression>
+#include <QScrollBar>
 #include <QTextBrowser>
-#include <QUrl>
+#include <QTextCursor>
 
 // KDE includes
-#include <KIO/FileCopyJob>
-#include <KJob>
 #include <KLocalizedString>
 
 // QApt includes
 #include <QApt/Package>
-#include <QApt/Changelog>
 
+#include "muonapt/ChangelogCache.h"
+#include "MuonSettings.h"
 #include "Widgets/BusyIndicator.h"
 
+// Entries shown when there is no installed version to compare with
+constexpr int initialEntryCount = 5;
+// Older entries added at a time when scrolling down
+constexpr int olderEntryBatch = 10;
+
+static ParsedChangelog parseChangelog(const QString &key, const QByteArray &data)
+{
+    // Every entry starts with an unindented "package (version) suite; urgency=..."
+    static const QRegularExpression headerExpression(QStringLiteral("^\\S+ \\(([^)]+)\\)"),
+                                                     QRegularExpression::MultilineOption);
+
+    ParsedChangelog changelog;
+    changelog.key = key;
+
+    const QString text = QString::fromUtf8(data);
+    QRegularExpressionMatchIterator it = headerExpression.globalMatch(text);
+    int entryStart = -1;
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        if (entryStart != -1) {
+            changelog.entries.append(text.mid(entryStart, match.capturedStart() - entryStart).trimmed());
+        }
+        changelog.versions.append(match.captured(1));
+        entryStart = match.capturedStart();
+    }
+
+    if (entryStart != -1) {
+        changelog.entries.append(text.mid(entryStart).trimmed());
+    } else if (!text.trimmed().isEmpty()) {
+        // Not in the Debian format, show it as it is
+        changelog.versions.append(QString());
+        changelog.entries.append(text.trimmed());
+    }
+
+    return changelog;
+}
+
 ChangelogTab::ChangelogTab(QWidget *parent)
     : DetailsTab(parent)
+    , m_parsedChangelogs(8 * 1024)
+    , m_shownEntries(0)
 {
     m_name = i18nc("@title:tab", "Changes List");
 
@@ -48,6 +87,19 @@ ChangelogTab::ChangelogTab(QWidget *parent)
     m_busyWidget = new BusyIndicator(m_changelogBrowser->viewport());
 
     m_layout->addWidget(m_changelogBrowser);
+
+    m_parseWatcher = new QFutureWatcher<ParsedChangelog>(this);
+    connect(m_parseWatcher, &QFutureWatcher<ParsedChangelog>::finished, this, &ChangelogTab::changelogParsed);
+
+    // Older entries come in as the end of what is shown scrolls into view. Range
+    // changes cover the case where everything shown fits without scrolling
+    QScrollBar *scrollBar = m_changelogBrowser->verticalScrollBar();
+    connect(scrollBar, &QScrollBar::valueChanged, this, &ChangelogTab::loadOlderEntries, Qt::QueuedConnection);
+    connect(scrollBar, &QScrollBar::rangeChanged, this, &ChangelogTab::loadOlderEntries, Qt::QueuedConnection);
+
+    ChangelogCache *cache = ChangelogCache::self();
+    connect(cache, &ChangelogCache::changelogFetched, this, &ChangelogTab::changelogFetched);
+    connect(cache, &ChangelogCache::fetchFailed, this, &ChangelogTab::fetchFailed);
 }
 
 void ChangelogTab::setPackage(QApt::Package *package)
@@ -55,6 +107,14 @@ void ChangelogTab::setPackage(QApt::Package *package)
     m_package = package;
 }
 
+void ChangelogTab::prefetch(QApt::Package *package)
+{
+    // Downloads are only made ahead of time when the user asked for that
+    if (MuonSettings::self()->prefetchChangelogs()) {
+        ChangelogCache::self()->prefetch({ ChangelogRequest::forPackage(package) });
+    }
+}
+
 void ChangelogTab::refresh()
 {
     fetchChangelog();
@@ -64,44 +124,155 @@ void ChangelogTab::clear()
 {
     DetailsTab::clear();
 
-    // Delete any KJobs lying around. We could get stale package pointers if the jobs
-    // finish during a cache reload
-    auto iter = m_jobFilenames.constBegin();
-    while (iter != m_jobFilenames.constEnd()) {
-        iter.key()->deleteLater();
-        ++iter;
+    // Results for the old package pointer are of no use after a cache reload
+    m_changelogKey.clear();
+    ChangelogCache::self()->cancelFetch();
+    m_shownChangelog = ParsedChangelog();
+    m_shownEntries = 0;
+}
+
+void ChangelogTab::showChangelog()
+{
+    const QString path = ChangelogCache::self()->changelogPath(m_changelogKey);
+
+    // Changelogs parsed before need no trip to the disk
+    if (ParsedChangelog *parsed = m_parsedChangelogs.object(m_changelogKey)) {
+        renderChangelog(*parsed);
+        return;
+    }
+
+    if (path.isEmpty()) {
+        fetchFailed(m_changelogKey);
+        return;
     }
 
-    m_jobFilenames.clear();
+    m_shownChangelog = ParsedChangelog();
+    m_shownEntries = 0;
+    m_changelogBrowser->clear();
+    m_busyWidget->start();
+
+    // Changelogs of core packages run into megabytes, so reading them is
+    // left to the worker as well
+    const QString key = m_changelogKey;
+    m_parseWatcher->setFuture(QtConcurrent::run([key, path]() {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return ParsedChangelog{ key, QStringList(), QStringList() };
+        }
+        return parseChangelog(key, file.readAll());
+    }));
 }
 
-void ChangelogTab::changelogFetched(KJob *job)
+void ChangelogTab::changelogParsed()
+{
+    const ParsedChangelog parsed = m_parseWatcher->result();
+
+    // Nothing in it, or the file could not be read
+    if (!parsed.entries.isEmpty()) {
+        int cost = 0;
+        for (const QString &entry : parsed.entries) {
+            cost += entry.size();
+        }
+        m_parsedChangelogs.insert(parsed.key, new ParsedChangelog(parsed), qMax(1, cost / 1024));
+    }
+
+    if (m_package && parsed.key == m_changelogKey) {
+        if (parsed.entries.isEmpty()) {
+            fetchFailed(parsed.key);
+        } else {
+            renderChangelog(parsed);
+        }
+    } else if (m_package && !m_changelogKey.isEmpty() && !m_parsedChangelogs.contains(m_changelogKey)
+               && ChangelogCache::self()->contains(m_changelogKey)) {
+        // Another changelog was requested while this one was being parsed
+        showChangelog();
+    }
+}
+
+void ChangelogTab::renderChangelog(const ParsedChangelog &changelog)
 {
     // Work around http://bugreports.qt.nokia.com/browse/QTBUG-2533 by forcibly resetting the CharFormat
     QTextCharFormat format;
     m_changelogBrowser->setCurrentCharFormat(format);
-    QFile changelogFile(m_jobFilenames[job]);
-
-    m_jobFilenames.remove(job);
 
     m_busyWidget->stop();
-    if (job->error() || !changelogFile.open(QFile::ReadOnly)) {
-        if (m_package->origin() == QStringLiteral("Ubuntu")) {
-            m_changelogBrowser->setText(xi18nc("@info/rich", "The list of changes is not yet available. "
-                                               "Please use <link url='%1'>Launchpad</link> instead.",
-                                               QStringLiteral("http://launchpad.net/ubuntu/+source/") + m_package->sourcePackage()));
-        } else {
-            m_changelogBrowser->setText(i18nc("@info", "The list of changes is not yet available."));
+    m_shownChangelog = changelog;
+    m_shownEntries = 0;
+    m_changelogBrowser->clear();
+
+    // By default only show what an upgrade would bring in
+    int count = initialEntryCount;
+    const QString installedVersion = m_package->installedVersion();
+    if (!installedVersion.isEmpty()) {
+        count = 0;
+        while (count < changelog.versions.size()
+               && QApt::Package::compareVersion(changelog.versions.at(count), installedVersion) > 0) {
+            ++count;
         }
     }
-    else {
-        QTextStream stream(&changelogFile);
-        const QApt::Changelog log(stream.readAll(), m_package->sourcePackage());
-        m_changelogBrowser->setText(log.text());
+
+    appendEntries(qMax(1, count));
+    m_changelogBrowser->moveCursor(QTextCursor::Start);
+}
+
+void ChangelogTab::appendEntries(int count)
+{
+    const int end = qMin(m_shownEntries + count, int(m_shownChangelog.entries.size()));
+
+    QString text;
+    for (int i = m_shownEntries; i < end; ++i) {
+        if (i > 0) {
+            text += QLatin1String("\n\n");
+        }
+        text += m_shownChangelog.entries.at(i);
     }
+    m_shownEntries = end;
 
-    changelogFile.remove();
-    job->deleteLater();
+    QTextCursor cursor(m_changelogBrowser->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+}
+
+void ChangelogTab::loadOlderEntries()
+{
+    if (m_shownEntries >= m_shownChangelog.entries.size()) {
+        return;
+    }
+
+    QScrollBar *scrollBar = m_changelogBrowser->verticalScrollBar();
+    if (scrollBar->value() >= scrollBar->maximum() - scrollBar->pageStep()) {
+        appendEntries(olderEntryBatch);
+    }
+}
+
+void ChangelogTab::changelogFetched(const QString &key)
+{
+    if (!m_package || key != m_changelogKey) {
+        return;
+    }
+
+    showChangelog();
+}
+
+void ChangelogTab::fetchFailed(const QString &key)
+{
+    if (!m_package || key != m_changelogKey) {
+        return;
+    }
+
+    QTextCharFormat format;
+    m_changelogBrowser->setCurrentCharFormat(format);
+
+    m_busyWidget->stop();
+    m_shownChangelog = ParsedChangelog();
+    m_shownEntries = 0;
+    if (m_package->origin() == QStringLiteral("Ubuntu")) {
+        m_changelogBrowser->setText(xi18nc("@info/rich", "The list of changes is not yet available. "
+                                           "Please use <link url='%1'>Launchpad</link> instead.",
+                                           QStringLiteral("http://launchpad.net/ubuntu/+source/") + m_package->sourcePackage()));
+    } else {
+        m_changelogBrowser->setText(i18nc("@info", "The list of changes is not yet available."));
+    }
 }
 
 void ChangelogTab::fetchChangelog()
@@ -110,20 +281,15 @@ void ChangelogTab::fetchChangelog()
         return;
     }
 
+    const ChangelogRequest request = ChangelogRequest::forPackage(m_package);
+    m_changelogKey = request.key();
+
+    m_shownChangelog = ParsedChangelog();
+    m_shownEntries = 0;
     m_changelogBrowser->clear();
     m_busyWidget->start();
 
-    QTemporaryFile *changelogFile = new QTemporaryFile(QDir::tempPath() + QLatin1String("/muon_XXXXXX.txt"));
-    changelogFile->setAutoRemove(false);
-    changelogFile->open();
-    QString filename = changelogFile->fileName();
-    delete changelogFile;
-
-    KIO::FileCopyJob *getJob = KIO::file_copy(m_package->changelogUrl(),
-                               QUrl::fromLocalFile(filename), -1,
-                               KIO::Overwrite | KIO::HideProgressInfo);
-    getJob->setAutoDelete(false);
-    m_jobFilenames.insert(getJob, filename);
-    connect(getJob, SIGNAL(result(KJob*)),
-            this, SLOT(changelogFetched(KJob*)));
+    // Cached changelogs, such as prefetched upgrades, are reported right away.
+    // Anything still downloading for the previous package is cancelled
+    ChangelogCache::self()->fetch(request);
 }
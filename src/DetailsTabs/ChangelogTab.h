@@ -24,23 +24,49 @@
 #include "DetailsTab.h"
 
 // Qt includes
-#include <QtCore/QHash>
+#include <QtCore/QCache>
+#include <QtCore/QStringList>
+#include <QFutureWatcher>
 
 class QTextBrowser;
 
-class KJob;
 class BusyIndicator;
 
+/**
+ * A changelog split into its entries, newest first
+ */
+struct ParsedChangelog
+{
+    QString key;
+    QStringList versions;
+    QStringList entries;
+};
+
 class ChangelogTab : public DetailsTab
 {
     Q_OBJECT
 public:
     explicit ChangelogTab(QWidget *parent = nullptr);
 
+    void prefetch(QApt::Package *package) override;
+
 private:
     QTextBrowser *m_changelogBrowser;
     BusyIndicator *m_busyWidget = nullptr;
-    QHash<KJob *, QString> m_jobFilenames;
+    // Cache key of the changelog being shown or waited for
+    QString m_changelogKey;
+
+    // Parsing happens once per changelog, off the GUI thread
+    QFutureWatcher<ParsedChangelog> *m_parseWatcher;
+    QCache<QString, ParsedChangelog> m_parsedChangelogs;
+
+    // The changelog on display, and how many of its entries are shown
+    ParsedChangelog m_shownChangelog;
+    int m_shownEntries;
+
+    void showChangelog();
+    void renderChangelog(const ParsedChangelog &changelog);
+    void appendEntries(int count);
 
 public Q_SLOTS:
     void setPackage(QApt::Package *package);
@@ -49,7 +75,10 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void fetchChangelog();
-    void changelogFetched(KJob *job);
+    void changelogFetched(const QString &key);
+    void fetchFailed(const QString &key);
+    void changelogParsed();
+    void loadOlderEntries();
 };
 
 #endif
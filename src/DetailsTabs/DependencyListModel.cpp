@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "DependencyListModel.h"
+
+// Qt includes
+#include <QtCore/QRegularExpression>
+
+// KDE includes
+#include <KLocalizedString>
+
+// QApt includes
+#include <QApt/Package>
+
+// Own includes
+#include "DependsTab.h"
+
+static QString plainText(QString text)
+{
+    // QApt marks up the dependency types
+    static const QRegularExpression tags(QStringLiteral("<[^>]*>"));
+    text.remove(tags);
+    text.replace(QLatin1String("&lt;"), QLatin1String("<"));
+    text.replace(QLatin1String("&gt;"), QLatin1String(">"));
+    text.replace(QLatin1String("&amp;"), QLatin1String("&"));
+    return text.trimmed();
+}
+
+static QString packageOf(const QString &text)
+{
+    // Dependencies read "Depends: foo (>= 1.0) | bar", the first package wins
+    const int colon = text.indexOf(QLatin1String(": "));
+    int start = colon >= 0 ? colon + 2 : 0;
+    while (start < text.size() && text.at(start).isSpace()) {
+        ++start;
+    }
+    int end = start;
+    while (end < text.size() && !text.at(end).isSpace() && text.at(end) != QLatin1Char('|')
+           && text.at(end) != QLatin1Char(',') && text.at(end) != QLatin1Char('(')) {
+        ++end;
+    }
+    return text.mid(start, end - start);
+}
+
+QStringList DependencyList::linesFor(QApt::Package *package, int type)
+{
+    switch (type) {
+    case DependsTab::CurrentVersionType:
+        return package->dependencyList(false);
+    case DependsTab::LatestVersionType:
+        return package->dependencyList(true);
+    case DependsTab::ReverseDependsType:
+        return package->requiredByList();
+    case DependsTab::VirtualDependsType:
+        return package->providesList();
+    }
+
+    return QStringList();
+}
+
+DependencyList DependencyList::fromLines(const QStringList &lines, const QString &key)
+{
+    DependencyList list;
+    list.key = key;
+    list.entries.reserve(lines.size());
+    for (const QString &line : std::as_const(lines)) {
+        const QString text = plainText(line);
+        list.entries.append({ text, packageOf(text) });
+    }
+
+    return list;
+}
+
+DependencyListModel::DependencyListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void DependencyListModel::setEntries(const QVector<DependencyEntry> &entries)
+{
+    beginResetModel();
+    m_entries = entries;
+    m_message.clear();
+    endResetModel();
+}
+
+void DependencyListModel::setMessage(const QString &message)
+{
+    beginResetModel();
+    m_entries.clear();
+    m_message = message;
+    endResetModel();
+}
+
+void DependencyListModel::clear()
+{
+    setMessage(QString());
+}
+
+int DependencyListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return m_entries.isEmpty() ? !m_message.isEmpty() : m_entries.size();
+}
+
+QVariant DependencyListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (m_entries.isEmpty()) {
+        return role == Qt::DisplayRole ? m_message : QVariant();
+    }
+
+    const DependencyEntry &entry = m_entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.text;
+    case Qt::ToolTipRole:
+        if (!entry.package.isEmpty()) {
+            return i18nc("@info:tooltip", "Activate to show %1", entry.package);
+        }
+        break;
+    case PackageNameRole:
+        return entry.package;
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags DependencyListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid() || m_entries.isEmpty()) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef DEPENDENCYLISTMODEL_H
+#define DEPENDENCYLISTMODEL_H
+
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+namespace QApt
+{
+    class Package;
+}
+
+/**
+ * One line of a dependency list, as plain text, along with the package it
+ * refers to.
+ */
+struct DependencyEntry
+{
+    QString text;
+    QString package;
+};
+
+/**
+ * A dependency list computed for a package, tagged with the package and list
+ * type it belongs to.
+ */
+struct DependencyList
+{
+    QString key;
+    QVector<DependencyEntry> entries;
+
+    /**
+     * @returns the lines QApt has for the list of the given
+     * DependsTab::DepTypes type. Package data is not thread safe, so this has
+     * to run on the GUI thread.
+     */
+    static QStringList linesFor(QApt::Package *package, int type);
+    /**
+     * Turns the @p lines of a list into entries. Reverse dependencies of core
+     * libraries run into the thousands, so this is meant to run off the GUI
+     * thread.
+     */
+    static DependencyList fromLines(const QStringList &lines, const QString &key);
+};
+
+/**
+ * Flat model over a dependency list. When the list is empty, a single message
+ * row explains why.
+ */
+class DependencyListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum {
+        PackageNameRole = Qt::UserRole + 1
+    };
+
+    explicit DependencyListModel(QObject *parent = nullptr);
+
+    void setEntries(const QVector<DependencyEntry> &entries);
+    void setMessage(const QString &message);
+    void clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+    QVector<DependencyEntry> m_entries;
+    QString m_message;
+};
+
+#endif
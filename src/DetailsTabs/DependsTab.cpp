@@ -21,18 +21,31 @@
 #include "DependsTab.h"
 
 // Qt includes
-#include <QScrollBar>
-#include <QTextBrowser>
+#include <QtConcurrentRun>
 #include <QComboBox>
+#include <QFileDialog>
+#include <QListView>
+#include <QPushButton>
+#include <QtCore/QFile>
 
 // KDE includes
 #include <KLocalizedString>
+#include <KMessageBox>
 
 // QApt includes
 #include <QApt/Package>
 
+// Own includes
+#include "muonapt/DependencyGraph.h"
+#include "Widgets/BusyIndicator.h"
+
+// Number of lists kept around
+constexpr int cachedListCount = 64;
+
 DependsTab::DependsTab(QWidget *parent)
     : DetailsTab(parent)
+    , m_lists(cachedListCount)
+    , m_resultOutdated(false)
 {
     m_name = i18nc("@title:tab", "Dependencies");
 
@@ -41,11 +54,33 @@ DependsTab::DependsTab(QWidget *parent)
     m_comboBox->addItem(i18nc("@item:inlistbox", "Dependencies of the Latest Version"),  LatestVersionType);
     m_comboBox->addItem(i18nc("@item:inlistbox", "Dependants (Reverse Dependencies)"), ReverseDependsType);
     m_comboBox->addItem(i18nc("@item:inlistbox", "Virtual Packages Provided"), VirtualDependsType);
+    m_comboBox->addItem(i18nc("@item:inlistbox", "Why Is This Package Installed"), WhyInstalledType);
+    m_comboBox->addItem(i18nc("@item:inlistbox", "Packages Removed Along With This One"), RemovalClosureType);
     connect(m_comboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(populateDepends(int)));
-    m_dependsBrowser = new QTextBrowser(this);
+
+    m_dependsModel = new DependencyListModel(this);
+
+    m_dependsView = new QListView(this);
+    m_dependsView->setModel(m_dependsModel);
+    m_dependsView->setUniformItemSizes(true);
+    m_dependsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    connect(m_dependsView, &QListView::activated, this, &DependsTab::entryActivated);
+
+    m_busyWidget = new BusyIndicator(m_dependsView->viewport());
+
+    m_watcher = new QFutureWatcher<DependencyList>(this);
+    connect(m_watcher, &QFutureWatcher<DependencyList>::finished, this, &DependsTab::dependsLoaded);
+
+    m_exportButton = new QPushButton(QIcon::fromTheme(QStringLiteral("document-export")),
+                                     i18nc("@action:button", "Export as Graphviz..."), this);
+    m_exportButton->hide();
+    connect(m_exportButton, &QPushButton::clicked, this, &DependsTab::exportGraph);
+
+    connect(DependencyGraphStore::self(), &DependencyGraphStore::loaded, this, &DependsTab::graphLoaded);
 
     m_layout->addWidget(m_comboBox);
-    m_layout->addWidget(m_dependsBrowser);
+    m_layout->addWidget(m_dependsView);
+    m_layout->addWidget(m_exportButton, 0, Qt::AlignRight);
 }
 
 void DependsTab::refresh()
@@ -54,54 +89,244 @@ void DependsTab::refresh()
         return; // Nothing to refresh yet, so return, else we crash
     }
 
-    m_dependsBrowser->setText(QString());
     populateDepends(m_comboBox->currentIndex());
 }
 
+void DependsTab::clear()
+{
+    DetailsTab::clear();
+
+    // Lists refer to the old cache, so start over after a reload
+    m_resultOutdated = m_watcher->isRunning();
+    m_lists.clear();
+    m_prefetching.clear();
+    m_pendingKey.clear();
+    m_graphNodes.clear();
+    m_exportButton->hide();
+    m_dependsModel->clear();
+    m_busyWidget->stop();
+}
+
 void DependsTab::populateDepends(int index)
 {
-    m_dependsBrowser->setText(QString());
-    QStringList list;
+    if (!m_package) {
+        return;
+    }
 
-    int depType = m_comboBox->itemData(index).toInt();
-    switch (depType) {
-    case CurrentVersionType:
-        list = m_package->dependencyList(false);
-        if (list.isEmpty()) {
-            m_dependsBrowser->append(i18nc("@label", "This package does not have any dependencies"));
+    const int depType = m_comboBox->itemData(index).toInt();
+    m_graphNodes.clear();
+    m_exportButton->hide();
+    if (depType == WhyInstalledType || depType == RemovalClosureType) {
+        populateGraphList(depType);
+        return;
+    }
+
+    const QString key = listKey(m_package, depType);
+    if (const QVector<DependencyEntry> *cached = m_lists.object(key)) {
+        m_pendingKey.clear();
+        m_busyWidget->stop();
+        showList(depType, *cached);
+        return;
+    }
+
+    if (key == m_pendingKey) {
+        return;
+    }
+    m_pendingKey = key;
+
+    m_dependsModel->clear();
+    m_busyWidget->start();
+    // The prefetch shows the list when it is done
+    if (m_prefetching.contains(key)) {
+        return;
+    }
+    m_resultOutdated = false;
+    m_watcher->setFuture(QtConcurrent::run(&DependencyList::fromLines,
+                                           DependencyList::linesFor(m_package, depType), key));
+}
+
+void DependsTab::dependsLoaded()
+{
+    const DependencyList list = m_watcher->result();
+    // Lists computed while the cache reloaded refer to the old cache
+    if (m_resultOutdated) {
+        return;
+    }
+    m_lists.insert(list.key, new QVector<DependencyEntry>(list.entries));
+
+    if (list.key != m_pendingKey) {
+        return;
+    }
+    m_pendingKey.clear();
+    m_busyWidget->stop();
+    showList(m_comboBox->currentData().toInt(), list.entries);
+}
+
+QString DependsTab::listKey(QApt::Package *package, int depType)
+{
+    return package->name() + QLatin1Char(':') + package->architecture()
+            + QLatin1Char('/') + QString::number(depType);
+}
+
+void DependsTab::prefetch(QApt::Package *package)
+{
+    // Graph queries take milliseconds, there is nothing to gain
+    const int depType = m_comboBox->currentData().toInt();
+    if (depType == WhyInstalledType || depType == RemovalClosureType) {
+        return;
+    }
+
+    const QString key = listKey(package, depType);
+    if (m_lists.contains(key) || m_prefetching.contains(key) || key == m_pendingKey) {
+        return;
+    }
+    m_prefetching.insert(key);
+
+    auto *watcher = new QFutureWatcher<DependencyList>(this);
+    const quint32 generation = m_generation;
+    connect(watcher, &QFutureWatcher<DependencyList>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation != m_generation) {
             return;
         }
-        break;
-    case LatestVersionType:
-        list = m_package->dependencyList(true);
-        if (list.isEmpty()) {
-            m_dependsBrowser->append(i18nc("@label", "This package does not have any dependencies"));
+
+        const DependencyList list = watcher->result();
+        m_prefetching.remove(list.key);
+        m_lists.insert(list.key, new QVector<DependencyEntry>(list.entries));
+
+        // The user got here before the prefetch was done
+        if (list.key == m_pendingKey) {
+            m_pendingKey.clear();
+            m_busyWidget->stop();
+            showList(m_comboBox->currentData().toInt(), list.entries);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(prefetchPool(), &DependencyList::fromLines,
+                                         DependencyList::linesFor(package, depType), key));
+}
+
+void DependsTab::populateGraphList(int depType)
+{
+    DependencyGraphStore *store = DependencyGraphStore::self();
+    if (!store->isLoaded()) {
+        // Lists computed earlier are of no interest anymore
+        m_pendingKey.clear();
+        m_dependsModel->clear();
+        m_busyWidget->start();
+        store->load();
+        return;
+    }
+    m_pendingKey.clear();
+    m_busyWidget->stop();
+
+    const DependencyGraph &graph = store->graph();
+    const int node = graph.node(DependencyGraph::nodeName(m_package));
+    if (node < 0 || !graph.isInstalled(node)) {
+        m_dependsModel->setMessage(i18nc("@label", "This package is not installed"));
+        return;
+    }
+
+    QVector<DependencyEntry> entries;
+    if (depType == WhyInstalledType) {
+        const QVector<DependencyGraph::Step> path = graph.whyInstalled(node);
+        if (path.isEmpty()) {
+            m_dependsModel->setMessage(i18nc("@label", "Nothing installed on purpose needs this package anymore"));
             return;
         }
-        break;
-    case ReverseDependsType:
-        list = m_package->requiredByList();
-        if (list.isEmpty()) {
-            m_dependsBrowser->append(i18nc("@label", "This package has no dependents. (Nothing depends on it.)"));
+
+        // The path runs from what was installed on purpose down to this package
+        QString indent;
+        for (const DependencyGraph::Step &step : path) {
+            const QString name = graph.name(step.node);
+            if (step.kind == DependencyGraph::NoEdge) {
+                entries.append({ i18nc("@item:inlistbox", "%1 (installed manually)", name), name });
+            } else {
+                entries.append({ indent + i18nc("@item:inlistbox %1 is a dependency type, %2 a package", "%1: %2",
+                                                DependencyGraph::edgeKindName(step.kind), name), name });
+            }
+            indent += QLatin1String("    ");
+            m_graphNodes.append(step.node);
+        }
+    } else {
+        const QVector<int> closure = graph.reverseClosure(node);
+        if (closure.isEmpty()) {
+            m_dependsModel->setMessage(i18nc("@label", "No other package depends on this one"));
             return;
         }
+
+        QStringList names;
+        for (int dependant : closure) {
+            names.append(graph.name(dependant));
+        }
+        names.sort();
+        for (const QString &name : std::as_const(names)) {
+            entries.append({ name, name });
+        }
+        m_graphNodes = closure;
+        m_graphNodes.prepend(node);
+    }
+
+    m_dependsModel->setEntries(entries);
+    m_dependsView->scrollToTop();
+    m_exportButton->show();
+}
+
+void DependsTab::graphLoaded()
+{
+    const int depType = m_comboBox->currentData().toInt();
+    if (m_package && (depType == WhyInstalledType || depType == RemovalClosureType)) {
+        populateGraphList(depType);
+    }
+}
+
+void DependsTab::exportGraph()
+{
+    if (m_graphNodes.isEmpty() || !m_package) {
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(this, i18nc("@title:window", "Export as Graphviz"),
+                                                          m_package->name() + QLatin1String(".dot"),
+                                                          i18nc("@item:inlistbox file type", "Graphviz files (*.dot *.gv)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(DependencyGraphStore::self()->graph().toGraphviz(m_graphNodes)) < 0) {
+        KMessageBox::error(this, xi18nc("@label", "The graph could not be saved, as it was not possible to "
+                                                  "write to <filename>%1</filename>", fileName));
+    }
+}
+
+void DependsTab::showList(int depType, const QVector<DependencyEntry> &entries)
+{
+    if (!entries.isEmpty()) {
+        m_dependsModel->setEntries(entries);
+        m_dependsView->scrollToTop();
+        return;
+    }
+
+    switch (depType) {
+    case CurrentVersionType:
+    case LatestVersionType:
+        m_dependsModel->setMessage(i18nc("@label", "This package does not have any dependencies"));
+        break;
+    case ReverseDependsType:
+        m_dependsModel->setMessage(i18nc("@label", "This package has no dependents. (Nothing depends on it.)"));
         break;
     case VirtualDependsType:
-        list = m_package->providesList();
-        if (list.isEmpty()) {
-            m_dependsBrowser->append(i18nc("@label", "This package does not provide any virtual packages"));
-            return;
-        }
+        m_dependsModel->setMessage(i18nc("@label", "This package does not provide any virtual packages"));
         break;
     }
+}
 
-    for(const QString &string: list) {
-            m_dependsBrowser->append(string);
+void DependsTab::entryActivated(const QModelIndex &index)
+{
+    const QString name = index.data(DependencyListModel::PackageNameRole).toString();
+    if (!name.isEmpty()) {
+        Q_EMIT packageRequested(name);
     }
-
-    QTextCursor cursor;
-    cursor.movePosition(QTextCursor::Start);
-    m_dependsBrowser->setTextCursor(cursor);
 }
 
 #include "moc_DependsTab.cpp"
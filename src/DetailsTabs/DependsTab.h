@@ -23,9 +23,18 @@
 
 #include "DetailsTab.h"
 
-class QTextBrowser;
+// Qt includes
+#include <QtCore/QCache>
+#include <QtCore/QSet>
+#include <QFutureWatcher>
+
+#include "DependencyListModel.h"
 
 class QComboBox;
+class QListView;
+class QPushButton;
+
+class BusyIndicator;
 
 class DependsTab : public DetailsTab
 {
@@ -33,22 +42,53 @@ class DependsTab : public DetailsTab
 public:
     explicit DependsTab(QWidget *parent = nullptr);
 
+    void prefetch(QApt::Package *package) override;
+
     enum DepTypes {
         CurrentVersionType = 0,
         LatestVersionType,
         ReverseDependsType,
-        VirtualDependsType
+        VirtualDependsType,
+        WhyInstalledType,
+        RemovalClosureType
     };
 
 private:
     QComboBox *m_comboBox;
-    QTextBrowser *m_dependsBrowser;
+    QListView *m_dependsView;
+    QPushButton *m_exportButton;
+    DependencyListModel *m_dependsModel;
+    BusyIndicator *m_busyWidget;
+    QFutureWatcher<DependencyList> *m_watcher;
+    // Recently computed lists by package and type, until the cache reloads
+    QCache<QString, QVector<DependencyEntry>> m_lists;
+    // Lists being prefetched
+    QSet<QString> m_prefetching;
+    // List that should be shown once computed
+    QString m_pendingKey;
+    // Set when the cache reloaded while a list was being computed
+    bool m_resultOutdated;
+
+    // Graph nodes of the list shown, for exporting
+    QVector<int> m_graphNodes;
+
+    static QString listKey(QApt::Package *package, int depType);
+    void showList(int depType, const QVector<DependencyEntry> &entries);
+    void populateGraphList(int depType);
 
 public Q_SLOTS:
     void refresh();
+    void clear() override;
 
 private Q_SLOTS:
     void populateDepends(int index);
+    void dependsLoaded();
+    void graphLoaded();
+    void exportGraph();
+    void entryActivated(const QModelIndex &index);
+
+Q_SIGNALS:
+    void packageRequested(const QString &name);
 };
 
 #endif
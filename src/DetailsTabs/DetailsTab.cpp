@@ -20,12 +20,15 @@
 
 #include "DetailsTab.h"
 
+#include <QCoreApplication>
+#include <QtCore/QThreadPool>
 #include <QtWidgets/QVBoxLayout>
 
 DetailsTab::DetailsTab(QWidget *parent)
     : QWidget(parent)
     , m_backend(nullptr)
     , m_package(nullptr)
+    , m_generation(0)
 {
     m_layout = new QVBoxLayout(this);
     m_layout->setContentsMargins(QMargins());
@@ -43,6 +46,21 @@ bool DetailsTab::shouldShow() const
     return true;
 }
 
+void DetailsTab::prefetch(QApt::Package * /*package*/)
+{
+}
+
+QThreadPool *DetailsTab::prefetchPool()
+{
+    static QThreadPool *pool = nullptr;
+    if (!pool) {
+        pool = new QThreadPool(QCoreApplication::instance());
+        pool->setMaxThreadCount(1);
+        pool->setThreadPriority(QThread::LowPriority);
+    }
+    return pool;
+}
+
 void DetailsTab::setBackend(QApt::Backend *backend)
 {
     m_backend = backend;
@@ -60,4 +78,6 @@ void DetailsTab::refresh()
 void DetailsTab::clear()
 {
     m_package = nullptr;
+    // Prefetches still running belong to the old cache, their results get dropped
+    ++m_generation;
 }
@@ -24,6 +24,8 @@
 #include <QtWidgets/QWidget>
 #include <QtWidgets/QVBoxLayout>
 
+class QThreadPool;
+
 namespace QApt
 {
     class Backend;
@@ -38,11 +40,21 @@ public:
 
     QString name() const;
     virtual bool shouldShow() const;
+    /**
+     * Computes what refresh() would show for @p package ahead of time, in case
+     * it is shown next. Tabs with expensive contents cache them.
+     */
+    virtual void prefetch(QApt::Package *package);
 
 protected:
     QApt::Backend *m_backend;
     QApt::Package *m_package;
     QString m_name;
+    // Bumped on clear(), prefetches started before belong to an older cache
+    quint32 m_generation;
+
+    /** Single low priority thread for prefetching, so it never competes with what is shown */
+    static QThreadPool *prefetchPool();
 
     QVBoxLayout *m_layout;
 
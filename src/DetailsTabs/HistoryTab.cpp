@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryTab.h"
+
+#include <algorithm>
+#include <functional>
+
+// Qt includes
+#include <QtCore/QDateTime>
+#include <QtCore/QLocale>
+#include <QtGui/QStandardItemModel>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QTreeView>
+
+// KDE includes
+#include <KLocalizedString>
+
+// QApt includes
+#include <QApt/Package>
+
+// Own includes
+#include "muonapt/HistoryView/HistoryDelegate.h"
+#include "muonapt/HistoryView/HistoryModel.h"
+#include "muonapt/HistoryView/HistoryStore.h"
+#include "Widgets/BusyIndicator.h"
+
+HistoryTab::HistoryTab(QWidget *parent)
+    : DetailsTab(parent)
+{
+    m_name = i18nc("@title:tab", "History");
+
+    m_historyModel = new QStandardItemModel(this);
+    m_historyModel->setHorizontalHeaderLabels({ i18nc("@title:column", "Action"),
+                                                i18nc("@title:column", "Time") });
+
+    m_delegate = new HistoryDelegate(this);
+
+    m_historyView = new QTreeView(this);
+    m_historyView->setModel(m_historyModel);
+    m_historyView->setItemDelegate(m_delegate);
+    m_historyView->setRootIsDecorated(false);
+    m_historyView->setUniformRowHeights(true);
+    m_historyView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_historyView->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+
+    m_emptyLabel = new QLabel(i18nc("@info", "There is no recorded history for this package."), this);
+    m_emptyLabel->setAlignment(Qt::AlignCenter);
+    m_emptyLabel->hide();
+
+    m_busyWidget = new BusyIndicator(m_historyView->viewport());
+
+    m_layout->addWidget(m_historyView);
+    m_layout->addWidget(m_emptyLabel);
+
+    connect(HistoryStore::self(), &HistoryStore::loaded, this, &HistoryTab::historyLoaded);
+    connect(HistoryStore::self(), &HistoryStore::appended, this, &HistoryTab::historyLoaded);
+}
+
+void HistoryTab::refresh()
+{
+    if (!m_package) {
+        return;
+    }
+
+    HistoryStore *store = HistoryStore::self();
+    if (!store->isLoaded()) {
+        m_historyModel->removeRows(0, m_historyModel->rowCount());
+        m_historyView->show();
+        m_emptyLabel->hide();
+        m_busyWidget->start();
+        store->load();
+        return;
+    }
+
+    populateHistory();
+}
+
+void HistoryTab::clear()
+{
+    DetailsTab::clear();
+    m_historyModel->removeRows(0, m_historyModel->rowCount());
+
+    // Cache reloads usually follow a transaction, which leaves new entries in
+    // the log. Only bother reading them if someone has looked at it before
+    HistoryStore *store = HistoryStore::self();
+    if (store->isLoaded()) {
+        store->update();
+    }
+}
+
+void HistoryTab::historyLoaded()
+{
+    m_busyWidget->stop();
+
+    if (m_package) {
+        populateHistory();
+    }
+}
+
+void HistoryTab::populateHistory()
+{
+    m_historyModel->removeRows(0, m_historyModel->rowCount());
+
+    const HistoryTable &table = HistoryStore::self()->table();
+
+    // Newer logs record names with their architecture, older ones without
+    QVector<int> events;
+    const int archId = table.packageId(m_package->name() + QLatin1Char(':') + m_package->architecture());
+    if (archId != -1) {
+        events += table.packageEvents(archId);
+    }
+    const int plainId = table.packageId(m_package->name());
+    if (plainId != -1) {
+        events += table.packageEvents(plainId);
+    }
+    std::sort(events.begin(), events.end(), std::greater<int>());
+
+    m_historyView->setVisible(!events.isEmpty());
+    m_emptyLabel->setVisible(events.isEmpty());
+
+    for (int eventIndex : std::as_const(events)) {
+        const HistoryEvent &event = table.events().at(eventIndex);
+        const QDateTime time = QDateTime::fromMSecsSinceEpoch(event.time);
+
+        QStandardItem *actionItem = new QStandardItem(HistoryModel::actionIcon(event.action),
+                                                      HistoryModel::actionName(event.action));
+        actionItem->setData(event.action, HistoryModel::HistoryActionRole);
+
+        QStandardItem *timeItem = new QStandardItem(QLocale().toString(time, QLocale::LongFormat));
+        timeItem->setData(event.action, HistoryModel::HistoryActionRole);
+
+        m_historyModel->appendRow({ actionItem, timeItem });
+    }
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef HISTORYTAB_H
+#define HISTORYTAB_H
+
+#include "DetailsTab.h"
+
+class QLabel;
+class QStandardItemModel;
+class QTreeView;
+
+class BusyIndicator;
+class HistoryDelegate;
+
+class HistoryTab : public DetailsTab
+{
+    Q_OBJECT
+public:
+    explicit HistoryTab(QWidget *parent = nullptr);
+
+private:
+    QTreeView *m_historyView;
+    QStandardItemModel *m_historyModel;
+    HistoryDelegate *m_delegate;
+    QLabel *m_emptyLabel;
+    BusyIndicator *m_busyWidget;
+
+public Q_SLOTS:
+    void refresh() override;
+    void clear() override;
+
+private Q_SLOTS:
+    void historyLoaded();
+    void populateHistory();
+};
+
+#endif
@@ -0,0 +1,311 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "InstalledFilesModel.h"
+
+#include <algorithm>
+
+// Qt includes
+#include <QtCore/QBitArray>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QStringBuilder>
+#include <QtGui/QIcon>
+
+FileTree FileTree::fromPaths(const QStringList &paths)
+{
+    struct TempNode {
+        QString name;
+        int parent;
+        QVector<int> children;
+    };
+
+    // First collect the tree as it comes...
+    QVector<TempNode> temp;
+    temp.append({ QString(), -1, {} });
+    QHash<QPair<int, QString>, int> lookup;
+
+    for (const QString &path : paths) {
+        int current = 0;
+        const QStringList components = path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+        for (const QString &component : components) {
+            if (component == QLatin1String(".")) {
+                continue;
+            }
+
+            const QPair<int, QString> key(current, component);
+            auto it = lookup.constFind(key);
+            if (it != lookup.constEnd()) {
+                current = it.value();
+                continue;
+            }
+
+            const int id = temp.size();
+            temp.append({ component, current, {} });
+            temp[current].children.append(id);
+            lookup.insert(key, id);
+            current = id;
+        }
+    }
+    lookup.clear();
+
+    // ...then lay it out breadth first, so that siblings end up next to each other
+    FileTree tree;
+    tree.m_nodes.reserve(temp.size());
+    QVector<int> newIndex(temp.size());
+    QVector<int> order;
+    order.reserve(temp.size());
+    order.append(0);
+
+    for (int i = 0; i < order.size(); ++i) {
+        TempNode &node = temp[order.at(i)];
+        std::sort(node.children.begin(), node.children.end(), [&temp](int a, int b) {
+            const bool aIsDir = !temp.at(a).children.isEmpty();
+            const bool bIsDir = !temp.at(b).children.isEmpty();
+            if (aIsDir != bIsDir) {
+                return aIsDir;
+            }
+            return temp.at(a).name < temp.at(b).name;
+        });
+
+        newIndex[order.at(i)] = i;
+        const int parent = node.parent == -1 ? -1 : newIndex.at(node.parent);
+        tree.m_nodes.append({ node.name, parent, int(order.size()), int(node.children.size()) });
+        order += node.children;
+    }
+
+    return tree;
+}
+
+FileTree FileTree::forPackage(const QString &name, const QString &architecture)
+{
+    // Multi-arch packages have their architecture in the list file name
+    QFile file(QLatin1String("/var/lib/dpkg/info/") % name % QLatin1Char(':') % architecture % QLatin1String(".list"));
+    if (!file.exists()) {
+        file.setFileName(QLatin1String("/var/lib/dpkg/info/") % name % QLatin1String(".list"));
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return FileTree();
+    }
+
+    QStringList paths;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (!line.isEmpty()) {
+            paths.append(QString::fromUtf8(line));
+        }
+    }
+
+    return fromPaths(paths);
+}
+
+int FileTree::size() const
+{
+    return m_nodes.size();
+}
+
+const FileTree::Node &FileTree::node(int index) const
+{
+    return m_nodes.at(index);
+}
+
+QString FileTree::path(int index) const
+{
+    QStringList components;
+    for (int i = index; i > 0; i = m_nodes.at(i).parent) {
+        components.prepend(m_nodes.at(i).name);
+    }
+    return QLatin1Char('/') + components.join(QLatin1Char('/'));
+}
+
+int FileTree::entryCount() const
+{
+    return qMax(0, int(m_nodes.size()) - 1);
+}
+
+InstalledFilesModel::InstalledFilesModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_filtering(false)
+    , m_visibleCount(0)
+{
+}
+
+void InstalledFilesModel::setTree(const FileTree &tree)
+{
+    beginResetModel();
+    m_tree = tree;
+    m_filtering = false;
+    m_filteredChildren.clear();
+    m_childOffsets.clear();
+    m_childCounts.clear();
+    m_rows.clear();
+    m_visibleCount = m_tree.entryCount();
+    endResetModel();
+}
+
+void InstalledFilesModel::setFilter(const QString &text)
+{
+    beginResetModel();
+
+    m_filtering = !text.isEmpty();
+    m_filteredChildren.clear();
+    m_childOffsets.clear();
+    m_childCounts.clear();
+    m_rows.clear();
+    m_visibleCount = m_tree.entryCount();
+
+    if (m_filtering && m_tree.size() > 0) {
+        const int size = m_tree.size();
+
+        // Parents come before their children, so one pass down marks what is
+        // in a matching directory, and one pass up marks the directories
+        // leading to a match
+        QBitArray matched(size);
+        for (int i = 1; i < size; ++i) {
+            const FileTree::Node &node = m_tree.node(i);
+            if (matched.testBit(node.parent) || node.name.contains(text, Qt::CaseInsensitive)) {
+                matched.setBit(i);
+            }
+        }
+
+        QBitArray visible = matched;
+        for (int i = size - 1; i > 0; --i) {
+            if (visible.testBit(i)) {
+                visible.setBit(m_tree.node(i).parent);
+            }
+        }
+        visible.setBit(0);
+
+        m_childOffsets.resize(size);
+        m_childCounts.resize(size);
+        m_rows.resize(size);
+        m_visibleCount = 0;
+        for (int i = 0; i < size; ++i) {
+            const FileTree::Node &node = m_tree.node(i);
+            m_childOffsets[i] = m_filteredChildren.size();
+            for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+                if (visible.testBit(child)) {
+                    m_rows[child] = m_filteredChildren.size() - m_childOffsets.at(i);
+                    m_filteredChildren.append(child);
+                }
+            }
+            m_childCounts[i] = m_filteredChildren.size() - m_childOffsets.at(i);
+        }
+        m_visibleCount = m_filteredChildren.size();
+    }
+
+    endResetModel();
+}
+
+int InstalledFilesModel::visibleCount() const
+{
+    return m_visibleCount;
+}
+
+int InstalledFilesModel::nodeAt(const QModelIndex &index) const
+{
+    // The root node is never shown, so its index doubles as the invalid one
+    return index.isValid() ? int(index.internalId()) : 0;
+}
+
+int InstalledFilesModel::childNode(int node, int row) const
+{
+    if (m_filtering) {
+        return m_filteredChildren.at(m_childOffsets.at(node) + row);
+    }
+    return m_tree.node(node).firstChild + row;
+}
+
+int InstalledFilesModel::childCount(int node) const
+{
+    if (m_filtering) {
+        return m_childCounts.at(node);
+    }
+    return m_tree.node(node).childCount;
+}
+
+int InstalledFilesModel::rowOf(int node) const
+{
+    if (m_filtering) {
+        return m_rows.at(node);
+    }
+    return node - m_tree.node(m_tree.node(node).parent).firstChild;
+}
+
+QModelIndex InstalledFilesModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, quintptr(childNode(nodeAt(parent), row)));
+}
+
+QModelIndex InstalledFilesModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+
+    const int parent = m_tree.node(nodeAt(child)).parent;
+    if (parent <= 0) {
+        return QModelIndex();
+    }
+
+    return createIndex(rowOf(parent), 0, quintptr(parent));
+}
+
+int InstalledFilesModel::rowCount(const QModelIndex &parent) const
+{
+    if (m_tree.size() == 0 || parent.column() > 0) {
+        return 0;
+    }
+
+    return childCount(nodeAt(parent));
+}
+
+int InstalledFilesModel::columnCount(const QModelIndex & /*parent*/) const
+{
+    return 1;
+}
+
+bool InstalledFilesModel::hasChildren(const QModelIndex &parent) const
+{
+    return rowCount(parent) > 0;
+}
+
+QVariant InstalledFilesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const int node = nodeAt(index);
+    switch (role) {
+    case Qt::DisplayRole:
+        return m_tree.node(node).name;
+    case Qt::DecorationRole:
+        return QIcon::fromTheme(m_tree.node(node).childCount ? QStringLiteral("folder")
+                                                             : QStringLiteral("text-x-generic"));
+    case Qt::ToolTipRole:
+        return m_tree.path(node);
+    }
+
+    return QVariant();
+}
@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef INSTALLEDFILESMODEL_H
+#define INSTALLEDFILESMODEL_H
+
+#include <QtCore/QAbstractItemModel>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+/**
+ * Compact directory tree of a list of paths. Every path component is stored
+ * once, so files sharing a directory share its node.
+ *
+ * Nodes are in breadth-first order with the children of a node next to each
+ * other, directories first, so a node's children are a plain index range.
+ */
+class FileTree
+{
+public:
+    struct Node {
+        QString name;
+        int parent;     // -1 for the root
+        int firstChild;
+        int childCount;
+    };
+
+    /** Builds the tree of @p paths, which may come in any order */
+    static FileTree fromPaths(const QStringList &paths);
+    /** Reads the dpkg file list of the package. This is meant to run off the GUI thread. */
+    static FileTree forPackage(const QString &name, const QString &architecture);
+
+    int size() const;
+    const Node &node(int index) const;
+    QString path(int index) const;
+    /** @returns the number of files and directories, not counting the root */
+    int entryCount() const;
+
+private:
+    QVector<Node> m_nodes;
+};
+
+/**
+ * Tree model over a FileTree. Nothing is stored per row, the view only asks
+ * for the children of the directories it expands.
+ */
+class InstalledFilesModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    explicit InstalledFilesModel(QObject *parent = nullptr);
+
+    void setTree(const FileTree &tree);
+    /** Shows only entries whose name contains @p text, along with their directories and contents */
+    void setFilter(const QString &text);
+    /** @returns the number of entries left by the filter */
+    int visibleCount() const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    FileTree m_tree;
+
+    // Filter results, empty when not filtering. The visible children of node n
+    // are m_filteredChildren[m_childOffsets[n]] onwards, m_childCounts[n] of them
+    bool m_filtering;
+    QVector<int> m_filteredChildren;
+    QVector<int> m_childOffsets;
+    QVector<int> m_childCounts;
+    QVector<int> m_rows;
+    int m_visibleCount;
+
+    int nodeAt(const QModelIndex &index) const;
+    int childNode(int node, int row) const;
+    int childCount(int node) const;
+    int rowOf(int node) const;
+};
+
+#endif
@@ -21,7 +21,10 @@
 #include "InstalledFilesTab.h"
 
 // Qt includes
-#include <QTextBrowser>
+#include <QtConcurrentRun>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QTreeView>
 
 // KDE includes
 #include <KLocalizedString>
@@ -29,13 +32,40 @@
 // QApt includes
 #include <QApt/Package>
 
+// Own includes
+#include "Widgets/BusyIndicator.h"
+
+// Filter results up to this size are shown fully expanded
+constexpr int maximumExpandedCount = 2000;
+// Number of file lists kept around
+constexpr int cachedTreeCount = 8;
+
 InstalledFilesTab::InstalledFilesTab(QWidget *parent)
     : DetailsTab(parent)
+    , m_trees(cachedTreeCount)
 {
     m_name = i18nc("@title:tab", "Installed Files");
-    m_filesBrowser = new QTextBrowser(this);
 
-    m_layout->addWidget(m_filesBrowser);
+    m_filterEdit = new QLineEdit(this);
+    m_filterEdit->setClearButtonEnabled(true);
+    m_filterEdit->setPlaceholderText(i18nc("@info:placeholder", "Filter files..."));
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &InstalledFilesTab::filterChanged);
+
+    m_filesModel = new InstalledFilesModel(this);
+
+    m_filesView = new QTreeView(this);
+    m_filesView->setModel(m_filesModel);
+    m_filesView->setHeaderHidden(true);
+    m_filesView->setUniformRowHeights(true);
+    m_filesView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    m_busyWidget = new BusyIndicator(m_filesView->viewport());
+
+    m_watcher = new QFutureWatcher<FileTree>(this);
+    connect(m_watcher, &QFutureWatcher<FileTree>::finished, this, &InstalledFilesTab::filesListLoaded);
+
+    m_layout->addWidget(m_filterEdit);
+    m_layout->addWidget(m_filesView);
 }
 
 bool InstalledFilesTab::shouldShow() const
@@ -53,18 +83,113 @@ void InstalledFilesTab::refresh()
     populateFilesList();
 }
 
+void InstalledFilesTab::clear()
+{
+    DetailsTab::clear();
+
+    // A transaction may have changed the files, read them again next time
+    m_loadedPackage.clear();
+    m_watcherPackage.clear();
+    m_trees.clear();
+    m_prefetching.clear();
+    m_filesModel->setTree(FileTree());
+}
+
+QString InstalledFilesTab::packageKey(QApt::Package *package)
+{
+    return package->name() + QLatin1Char(':') + package->architecture();
+}
+
+void InstalledFilesTab::prefetch(QApt::Package *package)
+{
+    if (!package->isInstalled()) {
+        return;
+    }
+
+    const QString key = packageKey(package);
+    if (m_trees.contains(key) || m_prefetching.contains(key) || key == m_loadedPackage) {
+        return;
+    }
+    m_prefetching.insert(key);
+
+    auto *watcher = new QFutureWatcher<FileTree>(this);
+    const quint32 generation = m_generation;
+    connect(watcher, &QFutureWatcher<FileTree>::finished, this, [this, watcher, generation, key]() {
+        watcher->deleteLater();
+        if (generation != m_generation) {
+            return;
+        }
+
+        m_prefetching.remove(key);
+        m_trees.insert(key, new FileTree(watcher->result()));
+
+        // The user got here before the prefetch was done
+        if (key == m_loadedPackage && key != m_watcherPackage) {
+            showTree(watcher->result());
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(prefetchPool(), &FileTree::forPackage, package->name(), package->architecture()));
+}
+
 void InstalledFilesTab::populateFilesList()
 {
-    m_filesBrowser->clear();
-    QStringList filesList = m_package->installedFilesList();
-    std::sort(filesList.begin(), filesList.end());
-    QString filesString;
+    if (!m_package) {
+        return;
+    }
+
+    const QString key = packageKey(m_package);
+    if (key == m_loadedPackage) {
+        return;
+    }
+    m_loadedPackage = key;
 
-    for(const QString &file: filesList) {
-        filesString.append(file + QChar::fromLatin1('\n'));
+    if (const FileTree *tree = m_trees.object(key)) {
+        showTree(*tree);
+        return;
     }
 
-    m_filesBrowser->setPlainText(filesString);
+    m_filesModel->setTree(FileTree());
+    m_busyWidget->start();
+
+    // The prefetch shows the files when it is done
+    if (m_prefetching.contains(key)) {
+        return;
+    }
+
+    // Packages like texlive ship tens of thousands of files
+    m_watcherPackage = key;
+    m_watcher->setFuture(QtConcurrent::run(&FileTree::forPackage, m_package->name(), m_package->architecture()));
+}
+
+void InstalledFilesTab::filesListLoaded()
+{
+    const QString key = m_watcherPackage;
+    m_watcherPackage.clear();
+    if (key.isEmpty()) {
+        return;
+    }
+
+    const FileTree tree = m_watcher->result();
+    m_trees.insert(key, new FileTree(tree));
+    if (key == m_loadedPackage) {
+        showTree(tree);
+    }
+}
+
+void InstalledFilesTab::showTree(const FileTree &tree)
+{
+    m_busyWidget->stop();
+    m_filesModel->setTree(tree);
+    filterChanged(m_filterEdit->text());
+}
+
+void InstalledFilesTab::filterChanged(const QString &text)
+{
+    m_filesModel->setFilter(text);
+
+    if (!text.isEmpty() && m_filesModel->visibleCount() <= maximumExpandedCount) {
+        m_filesView->expandAll();
+    }
 }
 
 #include "moc_InstalledFilesTab.cpp"
@@ -23,7 +23,17 @@
 
 #include "DetailsTab.h"
 
-class QTextBrowser;
+// Qt includes
+#include <QtCore/QCache>
+#include <QtCore/QSet>
+#include <QFutureWatcher>
+
+#include "InstalledFilesModel.h"
+
+class QLineEdit;
+class QTreeView;
+
+class BusyIndicator;
 
 class InstalledFilesTab : public DetailsTab
 {
@@ -32,16 +42,33 @@ public:
     explicit InstalledFilesTab(QWidget *parent = nullptr);
 
     bool shouldShow() const;
+    void prefetch(QApt::Package *package) override;
 
 private:
-    QTextBrowser *m_filesBrowser;
+    QLineEdit *m_filterEdit;
+    QTreeView *m_filesView;
+    InstalledFilesModel *m_filesModel;
+    BusyIndicator *m_busyWidget;
+    QFutureWatcher<FileTree> *m_watcher;
+    // Package whose files are shown or being loaded, and the one m_watcher loads
+    QString m_loadedPackage;
+    QString m_watcherPackage;
+    // Recently read and prefetched file lists, until the cache reloads
+    QCache<QString, FileTree> m_trees;
+    QSet<QString> m_prefetching;
+
+    static QString packageKey(QApt::Package *package);
+    void showTree(const FileTree &tree);
 
 public Q_SLOTS:
     void setPackage(QApt::Package *package);
     void refresh() override;
+    void clear() override;
 
 private Q_SLOTS:
     void populateFilesList();
+    void filesListLoaded();
+    void filterChanged(const QString &text);
 };
 
 #endif
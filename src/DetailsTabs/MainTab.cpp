@@ -36,6 +36,9 @@
 #include <QApt/Backend>
 #include <QApt/Package>
 
+// Own includes
+#include "muonapt/DependencyGraph.h"
+
 MainTab::MainTab(QWidget *parent)
     : DetailsTab(parent)
 {
@@ -113,9 +116,15 @@ MainTab::MainTab(QWidget *parent)
             style()->pixelMetric(QStyle::PM_LayoutBottomMargin)
     );
 
+    m_estimateLabel = new QLabel(this);
+    m_estimateLabel->setWordWrap(true);
+    m_estimateLabel->hide();
+    connect(DependencyGraphStore::self(), &DependencyGraphStore::loaded, this, &MainTab::updateEstimate);
+
     m_descriptionBrowser = new QTextBrowser(this);
 
     m_layout->addLayout(headerBox);
+    m_layout->addWidget(m_estimateLabel);
     m_layout->addWidget(m_descriptionBrowser);
 }
 
@@ -183,6 +192,7 @@ void MainTab::refresh()
     }
 
     m_packageShortDescLabel->setText(m_package->name());
+    updateEstimate();
 
     m_descriptionBrowser->setText(m_package->longDescription());
 
@@ -200,6 +210,27 @@ void MainTab::refresh()
     }
 }
 
+void MainTab::updateEstimate()
+{
+    // Marked packages have the real numbers in the status bar already
+    const int marked = QApt::Package::ToInstall | QApt::Package::ToReInstall | QApt::Package::ToUpgrade
+            | QApt::Package::ToDowngrade | QApt::Package::ToRemove | QApt::Package::ToPurge;
+    if (!m_package || m_package->isInstalled() || (m_package->state() & marked)) {
+        m_estimateLabel->hide();
+        return;
+    }
+
+    DependencyGraphStore *store = DependencyGraphStore::self();
+    if (!store->isLoaded()) {
+        m_estimateLabel->hide();
+        store->load();
+        return;
+    }
+
+    m_estimateLabel->setText(DependencyGraph::estimateText(store->installEstimate(DependencyGraph::nodeName(m_package))));
+    m_estimateLabel->show();
+}
+
 void MainTab::emitSetInstall()
 {
     Q_EMIT setInstall(m_package);
@@ -58,9 +58,11 @@ private:
     QPushButton *m_cancelButton;
 
     QTextBrowser *m_descriptionBrowser;
+    QLabel *m_estimateLabel;
 
 public Q_SLOTS:
     void refresh();
+    void updateEstimate();
 
 private Q_SLOTS:
     void emitSetInstall();
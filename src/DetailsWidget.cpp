@@ -22,6 +22,7 @@
 
 // Qt
 #include <QScrollArea>
+#include <QtCore/QTimer>
 
 // KDE
 #include <KLocalizedString>
@@ -37,9 +38,17 @@
 #include "DetailsTabs/ChangelogTab.h"
 #include "DetailsTabs/InstalledFilesTab.h"
 #include "DetailsTabs/VersionTab.h"
+#include "DetailsTabs/HistoryTab.h"
+
+// Milliseconds to stay on a package before the next one is shown. This
+// covers keyboard auto-repeat, so holding an arrow key only shows where it stops
+constexpr int dwellTime = 150;
 
 DetailsWidget::DetailsWidget(QWidget *parent)
     : QTabWidget(parent)
+    , m_package(nullptr)
+    , m_shownPackage(nullptr)
+    , m_prefetchTab(nullptr)
 {
     setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Expanding);
     setDocumentMode(true);
@@ -47,10 +56,12 @@ DetailsWidget::DetailsWidget(QWidget *parent)
     DetailsTab *mainTab = new MainTab(this);
     m_detailsTabs.append(mainTab);
     m_detailsTabs.append(new TechnicalDetailsTab(this));
-    m_detailsTabs.append(new DependsTab(this));
+    DependsTab *dependsTab = new DependsTab(this);
+    m_detailsTabs.append(dependsTab);
     m_detailsTabs.append(new InstalledFilesTab(nullptr));
     m_detailsTabs.append(new VersionTab(nullptr));
     m_detailsTabs.append(new ChangelogTab(this));
+    m_detailsTabs.append(new HistoryTab(this));
 
     // Hide until a package is clicked
     hide();
@@ -71,10 +82,24 @@ DetailsWidget::DetailsWidget(QWidget *parent)
             this, SIGNAL(setKeep(QApt::Package*)));
     connect(mainTab, SIGNAL(setPurge(QApt::Package*)),
             this, SIGNAL(setPurge(QApt::Package*)));
+    connect(dependsTab, SIGNAL(packageRequested(QString)),
+            this, SIGNAL(packageRequested(QString)));
     connect(this, SIGNAL(emitHideButtonsSignal()),
 	    mainTab, SLOT(hideButtons()));
     connect(this, &DetailsWidget::currentChanged,
-            this, &DetailsWidget::refreshCurrentTab);
+            this, &DetailsWidget::currentTabChanged);
+
+    m_staleTabs.fill(true, m_detailsTabs.size());
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(dwellTime);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DetailsWidget::showPendingPackage);
+
+    m_prefetchTimer = new QTimer(this);
+    m_prefetchTimer->setSingleShot(true);
+    m_prefetchTimer->setInterval(0);
+    connect(m_prefetchTimer, &QTimer::timeout, this, &DetailsWidget::prefetchNeighbour);
 }
 
 DetailsWidget::~DetailsWidget()
@@ -90,18 +115,72 @@ void DetailsWidget::setBackend(QApt::Backend *backend)
 
 void DetailsWidget::setPackage(QApt::Package *package)
 {
-    bool tabChanged = false;
+    m_package = package;
+    // Neighbours of the previous package are of no use anymore
+    m_prefetchTimer->stop();
+    m_prefetchQueue.clear();
+
+    // The first package after a pause shows right away, the ones following it
+    // in quick succession wait until the selection settles
+    if (m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+        return;
+    }
+    m_refreshTimer->start();
+    showPendingPackage();
+}
+
+void DetailsWidget::setNeighbours(const QVector<QApt::Package *> &packages)
+{
+    m_pendingNeighbours = packages;
+}
+
+quint32 DetailsWidget::enabledTabs(QApt::Package *package)
+{
+    auto cached = m_enabledTabs.constFind(package);
+    if (cached != m_enabledTabs.constEnd()) {
+        return cached.value();
+    }
+
+    // Some checks, like the one for other versions, are not cheap. Tabs only
+    // depend on what is installed, which takes a reload to change
+    quint32 enabled = 0;
+    for (int i = 0; i < m_detailsTabs.size(); ++i) {
+        if (m_detailsTabs.at(i)->shouldShow()) {
+            enabled |= 1u << i;
+        }
+    }
+    m_enabledTabs.insert(package, enabled);
+    return enabled;
+}
+
+void DetailsWidget::showPendingPackage()
+{
+    if (!m_package || (m_package == m_shownPackage && isVisible())) {
+        return;
+    }
+    m_shownPackage = m_package;
+    m_neighbours = m_pendingNeighbours;
+
     for (DetailsTab *tab: m_detailsTabs) {
-        tab->setPackage(package);
+        tab->setPackage(m_package);
+    }
+    m_staleTabs.fill(true);
 
-        if (currentIndex() == indexOf(tab) && !tab->shouldShow()) {
+    const quint32 enabled = enabledTabs(m_package);
+    bool tabChanged = false;
+    for (int i = 0; i < m_detailsTabs.size(); ++i) {
+        DetailsTab *tab = m_detailsTabs.at(i);
+        const bool shown = enabled & (1u << i);
+        if (currentIndex() == indexOf(tab) && !shown) {
             setCurrentIndex(0);
             tabChanged = true;
         }
-        setTabEnabled(indexOf(tab), tab->shouldShow());
+        setTabEnabled(indexOf(tab), shown);
     }
+    // Other tabs catch up once they are activated
     if (!tabChanged) {
-        refreshCurrentTab();
+        currentTabChanged();
     }
 
     show();
@@ -113,10 +192,44 @@ void DetailsWidget::emitHideButtons()
 }
 
 void DetailsWidget::refreshCurrentTab()
+{
+    // A package waiting to be shown refreshes everything anyway
+    if (m_package != m_shownPackage) {
+        return;
+    }
+
+    m_staleTabs.fill(true);
+    currentTabChanged();
+}
+
+void DetailsWidget::currentTabChanged()
 {
     DetailsTab *tab = qobject_cast<DetailsTab *>(currentWidget());
-    if (tab) {
-        tab->refresh();
+    const int index = m_detailsTabs.indexOf(tab);
+    if (index < 0 || !m_staleTabs.at(index)) {
+        return;
+    }
+
+    m_staleTabs[index] = false;
+    tab->refresh();
+
+    // Whoever steps through the list goes to a neighbour next. Reading their
+    // details still takes the GUI thread, so that waits until the package
+    // shown got painted, one neighbour per event loop iteration
+    m_prefetchTab = tab;
+    m_prefetchQueue = m_neighbours;
+    m_prefetchTimer->start();
+}
+
+void DetailsWidget::prefetchNeighbour()
+{
+    if (!m_prefetchTab || m_prefetchQueue.isEmpty()) {
+        return;
+    }
+
+    m_prefetchTab->prefetch(m_prefetchQueue.takeFirst());
+    if (!m_prefetchQueue.isEmpty()) {
+        m_prefetchTimer->start();
     }
 }
 
@@ -126,6 +239,17 @@ void DetailsWidget::clear()
         tab->clear();
     }
 
+    m_refreshTimer->stop();
+    m_prefetchTimer->stop();
+    m_prefetchQueue.clear();
+    m_prefetchTab = nullptr;
+    m_package = nullptr;
+    m_shownPackage = nullptr;
+    m_pendingNeighbours.clear();
+    m_neighbours.clear();
+    m_enabledTabs.clear();
+    m_staleTabs.fill(true);
+
     hide();
 }
 
@@ -22,11 +22,13 @@
 #define DETAILSWIDGET_H
 
 // Qt includes
+#include <QtCore/QHash>
 #include <QtCore/QVector>
 #include <QTabWidget>
 #include <QtCore/QStandardPaths>
 
 class QScrollArea;
+class QTimer;
 
 namespace QApt
 {
@@ -45,14 +47,38 @@ public:
 
 private:
     QVector<DetailsTab *> m_detailsTabs;
+    // Package to show, and the one the tabs are showing
+    QApt::Package *m_package;
+    QApt::Package *m_shownPackage;
+    QTimer *m_refreshTimer;
+    // Tabs to enable for the packages seen since the last cache reload, one bit per tab
+    QHash<QApt::Package *, quint32> m_enabledTabs;
+    // Tabs that have not been refreshed since the package or its state changed
+    QVector<bool> m_staleTabs;
+    // Rows next to the package to show, and to the one shown
+    QVector<QApt::Package *> m_pendingNeighbours;
+    QVector<QApt::Package *> m_neighbours;
+    // Neighbours still to prefetch for the current tab, once the GUI is idle
+    QTimer *m_prefetchTimer;
+    DetailsTab *m_prefetchTab;
+    QVector<QApt::Package *> m_prefetchQueue;
+
+    quint32 enabledTabs(QApt::Package *package);
 
 public Q_SLOTS:
     void setBackend(QApt::Backend *backend);
     void setPackage(QApt::Package *package);
+    /** Sets the packages next to the one passed to setPackage() next, to prefetch their details */
+    void setNeighbours(const QVector<QApt::Package *> &packages);
     void refreshCurrentTab();
     void clear();
     void emitHideButtons();
 
+private Q_SLOTS:
+    void showPendingPackage();
+    void currentTabChanged();
+    void prefetchNeighbour();
+
 Q_SIGNALS:
     void setInstall(QApt::Package *package);
     void setRemove(QApt::Package *package);
@@ -61,6 +87,7 @@ Q_SIGNALS:
     void setKeep(QApt::Package *package);
     void setPurge(QApt::Package *package);
     void emitHideButtonsSignal();
+    void packageRequested(const QString &name);
 };
 
 #endif
@@ -24,16 +24,21 @@
 
 DownloadModel::DownloadModel(QObject *parent)
 : QAbstractListModel(parent)
+, m_firstDirtyRow(-1)
+, m_lastDirtyRow(-1)
 {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(16);
+    connect(&m_flushTimer, &QTimer::timeout, this, &DownloadModel::flushUpdates);
 }
 
 QVariant DownloadModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid() || index.row() > m_itemList.size() || index.row() < 0) {
+    if (!index.isValid() || index.row() >= m_itemList.size() || index.row() < 0) {
         return QVariant();
     }
 
-    QApt::DownloadProgress details = m_itemList.at(index.row());
+    const QApt::DownloadProgress &details = m_itemList.at(index.row());
     switch (role) {
     case NameRole:
         return QVariant(details.shortDescription());
@@ -71,33 +76,52 @@ QVariant DownloadModel::headerData(int section, Qt::Orientation orientation, int
 
 void DownloadModel::updateDetails(const QApt::DownloadProgress &details)
 {
-    bool newPackage = true;
-    for (int i = 0; i < m_itemList.size(); ++i) {
-        // URI should be unique
-        if (m_itemList.at(i).uri() != details.uri()) {
-            continue;
-        }
+    // URI should be unique
+    auto it = m_rowForUri.constFind(details.uri());
+    if (it == m_rowForUri.constEnd()) {
+        m_rowForUri.insert(details.uri(), m_itemList.size() + m_pendingItems.size());
+        m_pendingItems.append(details);
+    } else if (it.value() >= m_itemList.size()) {
+        m_pendingItems[it.value() - m_itemList.size()] = details;
+    } else {
+        const int row = it.value();
+        m_itemList[row] = details;
+        m_firstDirtyRow = (m_firstDirtyRow == -1) ? row : qMin(m_firstDirtyRow, row);
+        m_lastDirtyRow = qMax(m_lastDirtyRow, row);
+    }
 
-        newPackage = false;
-        m_itemList[i] = details;
-        // If we get more than 10 columns we'll have to bump this.
-        // ... but that's really not likely...
-        Q_EMIT dataChanged(index(i, 0), index(i, 9));
-        break;
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
     }
+}
 
-    if (newPackage) {
-        beginInsertRows(QModelIndex(), m_itemList.count(), m_itemList.count());
-        m_itemList.append(details);
-        endInsertRows();
+void DownloadModel::flushUpdates()
+{
+    if (m_firstDirtyRow != -1) {
+        Q_EMIT dataChanged(index(m_firstDirtyRow, 0), index(m_lastDirtyRow, columnCount() - 1));
+        m_firstDirtyRow = -1;
+        m_lastDirtyRow = -1;
     }
 
-    return;
+    if (!m_pendingItems.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_itemList.size(), m_itemList.size() + m_pendingItems.size() - 1);
+        m_itemList += m_pendingItems;
+        m_pendingItems.clear();
+        endInsertRows();
+    }
 }
 
 void DownloadModel::clear()
 {
+    m_flushTimer.stop();
+
+    beginResetModel();
     m_itemList.clear();
+    m_rowForUri.clear();
+    m_pendingItems.clear();
+    m_firstDirtyRow = -1;
+    m_lastDirtyRow = -1;
+    endResetModel();
 }
 
 int DownloadModel::rowCount(const QModelIndex& /*parent*/) const
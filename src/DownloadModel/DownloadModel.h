@@ -21,6 +21,8 @@
 #ifndef DOWNLOADMODEL_H
 #define DOWNLOADMODEL_H
 
+#include <QtCore/QHash>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
 #include <QModelIndex>
 
@@ -49,11 +51,20 @@ public Q_SLOTS:
     void updateDetails(const QApt::DownloadProgress &details);
     void clear();
 
-Q_SIGNALS:
-    void dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+private Q_SLOTS:
+    void flushUpdates();
 
 private:
     QVector<QApt::DownloadProgress> m_itemList;
+    // Row of every URI, including the pending ones past the end of m_itemList
+    QHash<QString, int> m_rowForUri;
+
+    // Progress arrives much faster than anyone can watch it, so changes are
+    // collected here and handed to the views at most once per frame
+    QVector<QApt::DownloadProgress> m_pendingItems;
+    int m_firstDirtyRow;
+    int m_lastDirtyRow;
+    QTimer m_flushTimer;
 };
 
 #endif // DOWNLOADMODEL_H
@@ -0,0 +1,285 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "DownloadStatistics.h"
+
+#include <algorithm>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QUrl>
+
+#include <QApt/DownloadProgress>
+
+// Rates are averaged over this many milliseconds
+constexpr qint64 windowLength = 5000;
+
+DownloadStatistics::DownloadStatistics()
+    : m_totalBytes(0)
+    , m_windowBytes(0)
+{
+}
+
+void DownloadStatistics::start()
+{
+    m_totalBytes = 0;
+    m_files.clear();
+    m_fileForUri.clear();
+    m_hostForName.clear();
+    m_phases.clear();
+    m_window.clear();
+    m_windowBytes = 0;
+    m_hosts.clear();
+    m_clock.start();
+}
+
+void DownloadStatistics::addProgress(const QApt::DownloadProgress &progress)
+{
+    if (!m_clock.isValid()) {
+        m_clock.start();
+    }
+
+    const qint64 now = m_clock.elapsed();
+
+    auto it = m_fileForUri.constFind(progress.uri());
+    if (it == m_fileForUri.constEnd()) {
+        it = m_fileForUri.insert(progress.uri(), m_files.size());
+        m_files.append({ progress.uri(), hostForUri(progress.uri()), 0, 0, now, now, false });
+        m_hosts[m_files.last().host].fileCount++;
+    }
+    FileStats &file = m_files[it.value()];
+
+    const bool done = progress.status() == QApt::DoneState;
+    qint64 bytes = progress.partialSize();
+    if (done) {
+        bytes = qMax(bytes, progress.fileSize());
+    }
+
+    // A retry starts over from zero. The drop is not counted, but what it
+    // fetches again does count, as those bytes do go over the wire again
+    const qint64 delta = bytes - file.bytes;
+    file.size = qMax(file.size, progress.fileSize());
+    file.bytes = bytes;
+    if (!file.finished) {
+        file.endTime = now;
+    }
+    file.finished = file.finished || done;
+
+    if (delta > 0) {
+        m_totalBytes += delta;
+        m_hosts[file.host].bytes += delta;
+        m_hosts[file.host].windowBytes += delta;
+        m_windowBytes += delta;
+        m_window.enqueue({ now, delta, file.host });
+    }
+
+    trimWindow();
+}
+
+void DownloadStatistics::beginPhase(const QString &name)
+{
+    if (!m_phases.isEmpty() && m_phases.constLast().name == name) {
+        return;
+    }
+
+    m_phases.append({ name, elapsed() });
+}
+
+bool DownloadStatistics::isEmpty() const
+{
+    return m_files.isEmpty();
+}
+
+qint64 DownloadStatistics::elapsed() const
+{
+    return m_clock.isValid() ? m_clock.elapsed() : 0;
+}
+
+qint64 DownloadStatistics::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+qint64 DownloadStatistics::remainingBytes() const
+{
+    qint64 remaining = 0;
+    for (const FileStats &file : m_files) {
+        if (!file.finished && file.size > file.bytes) {
+            remaining += file.size - file.bytes;
+        }
+    }
+    return remaining;
+}
+
+double DownloadStatistics::currentRate() const
+{
+    trimWindow();
+    const qint64 span = windowSpan();
+    return span > 0 ? m_windowBytes * 1000.0 / span : 0.0;
+}
+
+double DownloadStatistics::averageRate() const
+{
+    const qint64 msecs = elapsed();
+    return msecs > 0 ? m_totalBytes * 1000.0 / msecs : 0.0;
+}
+
+double DownloadStatistics::hostRate(const HostStats &host) const
+{
+    trimWindow();
+    const qint64 span = windowSpan();
+    return span > 0 ? host.windowBytes * 1000.0 / span : 0.0;
+}
+
+qint64 DownloadStatistics::secondsRemaining() const
+{
+    const double rate = currentRate();
+    if (rate < 1.0) {
+        return -1;
+    }
+
+    return qint64(remainingBytes() / rate);
+}
+
+QVector<DownloadStatistics::HostStats> DownloadStatistics::hosts() const
+{
+    trimWindow();
+
+    QVector<HostStats> hosts = m_hosts;
+    std::sort(hosts.begin(), hosts.end(), [](const HostStats &a, const HostStats &b) {
+        return a.bytes > b.bytes;
+    });
+    return hosts;
+}
+
+QVector<DownloadStatistics::FileStats> DownloadStatistics::slowestFiles(int count) const
+{
+    QVector<FileStats> files;
+    for (const FileStats &file : m_files) {
+        // Index files that were already up to date say nothing about the mirror
+        if (file.bytes > 0) {
+            files.append(file);
+        }
+    }
+
+    count = qMin(count, int(files.size()));
+    std::partial_sort(files.begin(), files.begin() + count, files.end(), [](const FileStats &a, const FileStats &b) {
+        return fileRate(a) < fileRate(b);
+    });
+    files.resize(count);
+    return files;
+}
+
+QString DownloadStatistics::hostName(int host) const
+{
+    return m_hosts.at(host).host;
+}
+
+QJsonObject DownloadStatistics::toJson() const
+{
+    QJsonArray phases;
+    for (int i = 0; i < m_phases.size(); ++i) {
+        const qint64 end = (i + 1 < m_phases.size()) ? m_phases.at(i + 1).startTime : elapsed();
+        phases.append(QJsonObject {
+            { QStringLiteral("name"), m_phases.at(i).name },
+            { QStringLiteral("startMsecs"), m_phases.at(i).startTime },
+            { QStringLiteral("durationMsecs"), end - m_phases.at(i).startTime }
+        });
+    }
+
+    // Per-host averages are over the time any of its files were in flight
+    QVector<qint64> firstTimes(m_hosts.size(), -1);
+    QVector<qint64> lastTimes(m_hosts.size(), 0);
+    for (const FileStats &file : m_files) {
+        qint64 &first = firstTimes[file.host];
+        first = (first == -1) ? file.startTime : qMin(first, file.startTime);
+        lastTimes[file.host] = qMax(lastTimes.at(file.host), file.endTime);
+    }
+
+    QJsonArray hosts;
+    for (int i = 0; i < m_hosts.size(); ++i) {
+        const HostStats &host = m_hosts.at(i);
+        const qint64 active = lastTimes.at(i) - firstTimes.at(i);
+        hosts.append(QJsonObject {
+            { QStringLiteral("host"), host.host },
+            { QStringLiteral("files"), host.fileCount },
+            { QStringLiteral("bytes"), host.bytes },
+            { QStringLiteral("activeMsecs"), active },
+            { QStringLiteral("bytesPerSecond"), active > 0 ? host.bytes * 1000.0 / active : 0.0 }
+        });
+    }
+
+    QJsonArray files;
+    for (const FileStats &file : m_files) {
+        files.append(QJsonObject {
+            { QStringLiteral("uri"), file.uri },
+            { QStringLiteral("host"), hostName(file.host) },
+            { QStringLiteral("size"), file.size },
+            { QStringLiteral("bytes"), file.bytes },
+            { QStringLiteral("startMsecs"), file.startTime },
+            { QStringLiteral("durationMsecs"), file.endTime - file.startTime },
+            { QStringLiteral("finished"), file.finished }
+        });
+    }
+
+    return QJsonObject {
+        { QStringLiteral("elapsedMsecs"), elapsed() },
+        { QStringLiteral("bytes"), m_totalBytes },
+        { QStringLiteral("bytesPerSecond"), averageRate() },
+        { QStringLiteral("phases"), phases },
+        { QStringLiteral("hosts"), hosts },
+        { QStringLiteral("files"), files }
+    };
+}
+
+void DownloadStatistics::trimWindow() const
+{
+    const qint64 cutoff = elapsed() - windowLength;
+    while (!m_window.isEmpty() && m_window.head().time < cutoff) {
+        const Sample sample = m_window.dequeue();
+        m_windowBytes -= sample.bytes;
+        m_hosts[sample.host].windowBytes -= sample.bytes;
+    }
+}
+
+qint64 DownloadStatistics::windowSpan() const
+{
+    // Don't spread the first few samples over a full window
+    return qMin(elapsed(), windowLength);
+}
+
+int DownloadStatistics::hostForUri(const QString &uri)
+{
+    const QUrl url(uri);
+    const QString name = url.host().isEmpty() ? url.scheme() : url.host();
+
+    auto it = m_hostForName.constFind(name);
+    if (it != m_hostForName.constEnd()) {
+        return it.value();
+    }
+
+    const int host = m_hosts.size();
+    m_hostForName.insert(name, host);
+    m_hosts.append({ name, 0, 0, 0 });
+    return host;
+}
+
+double DownloadStatistics::fileRate(const FileStats &file)
+{
+    const qint64 msecs = qMax<qint64>(1, file.endTime - file.startTime);
+    return file.bytes * 1000.0 / msecs;
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef DOWNLOADSTATISTICS_H
+#define DOWNLOADSTATISTICS_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QQueue>
+#include <QtCore/QVector>
+
+namespace QApt {
+    class DownloadProgress;
+}
+
+/**
+ * Throughput bookkeeping for one transaction, fed from its DownloadProgress
+ * stream.
+ *
+ * Rates are averaged over a sliding window of the last few seconds, both in
+ * total and per host. The time spent in each phase of the transaction is
+ * recorded too, so that slow downloads can be told apart from slow installs.
+ */
+class DownloadStatistics
+{
+public:
+    struct HostStats {
+        QString host;
+        qint64 bytes;
+        qint64 windowBytes;
+        int fileCount;
+    };
+
+    struct FileStats {
+        QString uri;
+        int host;
+        qint64 size;
+        qint64 bytes;
+        qint64 startTime;
+        qint64 endTime;
+        bool finished;
+    };
+
+    DownloadStatistics();
+
+    /** Forgets everything and starts the clock for a new transaction */
+    void start();
+    void addProgress(const QApt::DownloadProgress &progress);
+    /** Notes that the transaction entered phase @p name, which ends the previous phase */
+    void beginPhase(const QString &name);
+
+    bool isEmpty() const;
+    qint64 elapsed() const;
+    qint64 totalBytes() const;
+    qint64 remainingBytes() const;
+    /** @returns bytes per second over the sliding window */
+    double currentRate() const;
+    double averageRate() const;
+    /** @returns bytes per second of @p host over the sliding window */
+    double hostRate(const HostStats &host) const;
+    /** @returns the estimated seconds until the downloads are done, or -1 if unknown */
+    qint64 secondsRemaining() const;
+
+    /** @returns all hosts, the busiest first */
+    QVector<HostStats> hosts() const;
+    /** @returns up to @p count files with the lowest throughput */
+    QVector<FileStats> slowestFiles(int count) const;
+    QString hostName(int host) const;
+
+    QJsonObject toJson() const;
+
+private:
+    struct Sample {
+        qint64 time;
+        qint64 bytes;
+        int host;
+    };
+
+    struct Phase {
+        QString name;
+        qint64 startTime;
+    };
+
+    QElapsedTimer m_clock;
+    qint64 m_totalBytes;
+
+    QVector<FileStats> m_files;
+    QHash<QString, int> m_fileForUri;
+    QHash<QString, int> m_hostForName;
+    QVector<Phase> m_phases;
+
+    // Trimmed lazily by the const getters, hence mutable
+    mutable QQueue<Sample> m_window;
+    mutable qint64 m_windowBytes;
+    mutable QVector<HostStats> m_hosts;
+
+    void trimWindow() const;
+    qint64 windowSpan() const;
+    int hostForUri(const QString &uri);
+    static double fileRate(const FileStats &file);
+};
+
+#endif
@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "DownloadStatisticsWidget.h"
+
+// Qt includes
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QToolButton>
+#include <QtWidgets/QTreeWidget>
+#include <QtWidgets/QVBoxLayout>
+
+// KDE includes
+#include <KFormat>
+#include <KLocalizedString>
+
+// Own includes
+#include "DownloadStatistics.h"
+
+// Number of files listed as the slowest ones
+constexpr int slowFileCount = 5;
+
+DownloadStatisticsWidget::DownloadStatisticsWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_statistics(nullptr)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(QMargins());
+    setLayout(layout);
+
+    QWidget *header = new QWidget(this);
+    QHBoxLayout *headerLayout = new QHBoxLayout(header);
+    headerLayout->setContentsMargins(QMargins());
+    header->setLayout(headerLayout);
+
+    m_toggleButton = new QToolButton(header);
+    m_toggleButton->setText(i18nc("@action:button Shows download speed details", "Transfer Details"));
+    m_toggleButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    m_toggleButton->setArrowType(Qt::RightArrow);
+    m_toggleButton->setAutoRaise(true);
+    m_toggleButton->setCheckable(true);
+    connect(m_toggleButton, &QToolButton::toggled, this, &DownloadStatisticsWidget::setExpanded);
+
+    m_summaryLabel = new QLabel(header);
+
+    headerLayout->addWidget(m_toggleButton);
+    headerLayout->addWidget(m_summaryLabel, 1);
+    layout->addWidget(header);
+
+    m_body = new QWidget(this);
+    QHBoxLayout *bodyLayout = new QHBoxLayout(m_body);
+    bodyLayout->setContentsMargins(QMargins());
+    m_body->setLayout(bodyLayout);
+
+    m_hostView = new QTreeWidget(m_body);
+    m_hostView->setRootIsDecorated(false);
+    m_hostView->setUniformRowHeights(true);
+    m_hostView->setHeaderLabels({ i18nc("@title:column", "Server"),
+                                  i18nc("@title:column", "Downloaded"),
+                                  i18nc("@title:column", "Speed") });
+    m_hostView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_hostView->header()->setStretchLastSection(false);
+
+    m_fileView = new QTreeWidget(m_body);
+    m_fileView->setRootIsDecorated(false);
+    m_fileView->setUniformRowHeights(true);
+    m_fileView->setHeaderLabels({ i18nc("@title:column", "Slowest Files"),
+                                  i18nc("@title:column", "Size"),
+                                  i18nc("@title:column", "Time") });
+    m_fileView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_fileView->header()->setStretchLastSection(false);
+
+    bodyLayout->addWidget(m_hostView);
+    bodyLayout->addWidget(m_fileView);
+    layout->addWidget(m_body);
+    m_body->hide();
+}
+
+void DownloadStatisticsWidget::setStatistics(const DownloadStatistics *statistics)
+{
+    m_statistics = statistics;
+    refresh();
+}
+
+void DownloadStatisticsWidget::setExpanded(bool expanded)
+{
+    m_toggleButton->setArrowType(expanded ? Qt::DownArrow : Qt::RightArrow);
+    m_body->setVisible(expanded);
+    refresh();
+}
+
+void DownloadStatisticsWidget::refresh()
+{
+    if (!m_statistics || m_statistics->isEmpty()) {
+        m_summaryLabel->clear();
+        m_hostView->clear();
+        m_fileView->clear();
+        return;
+    }
+
+    KFormat format;
+    const qint64 secondsLeft = m_statistics->secondsRemaining();
+    const QString speed = format.formatByteSize(m_statistics->currentRate());
+    if (secondsLeft >= 0 && m_statistics->remainingBytes() > 0) {
+        m_summaryLabel->setText(i18nc("@info:status speed, amount downloaded, time left",
+                                      "%1/s, %2 downloaded, about %3 left",
+                                      speed,
+                                      format.formatByteSize(m_statistics->totalBytes()),
+                                      format.formatSpelloutDuration(secondsLeft * 1000)));
+    } else {
+        m_summaryLabel->setText(i18nc("@info:status speed, amount downloaded",
+                                      "%1/s, %2 downloaded",
+                                      speed,
+                                      format.formatByteSize(m_statistics->totalBytes())));
+    }
+
+    // Nobody is looking at the details, don't bother filling them in
+    if (!m_body->isVisible()) {
+        return;
+    }
+
+    m_hostView->clear();
+    const QVector<DownloadStatistics::HostStats> hosts = m_statistics->hosts();
+    for (const DownloadStatistics::HostStats &host : hosts) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_hostView);
+        item->setText(0, host.host);
+        item->setText(1, format.formatByteSize(host.bytes));
+        item->setText(2, i18nc("@item:intable download speed", "%1/s",
+                               format.formatByteSize(m_statistics->hostRate(host))));
+    }
+
+    m_fileView->clear();
+    const QVector<DownloadStatistics::FileStats> files = m_statistics->slowestFiles(slowFileCount);
+    for (const DownloadStatistics::FileStats &file : files) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_fileView);
+        item->setText(0, file.uri.section(QLatin1Char('/'), -1));
+        item->setToolTip(0, file.uri);
+        item->setText(1, format.formatByteSize(file.size));
+        item->setText(2, format.formatDuration(file.endTime - file.startTime));
+    }
+}
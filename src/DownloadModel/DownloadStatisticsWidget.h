@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef DOWNLOADSTATISTICSWIDGET_H
+#define DOWNLOADSTATISTICSWIDGET_H
+
+#include <QtWidgets/QWidget>
+
+class QLabel;
+class QToolButton;
+class QTreeWidget;
+
+class DownloadStatistics;
+
+/**
+ * Collapsible panel showing the throughput, the time left and the per-host
+ * and per-file figures of a DownloadStatistics.
+ */
+class DownloadStatisticsWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DownloadStatisticsWidget(QWidget *parent = nullptr);
+
+    void setStatistics(const DownloadStatistics *statistics);
+
+public Q_SLOTS:
+    void refresh();
+
+private Q_SLOTS:
+    void setExpanded(bool expanded);
+
+private:
+    const DownloadStatistics *m_statistics;
+
+    QToolButton *m_toggleButton;
+    QLabel *m_summaryLabel;
+    QWidget *m_body;
+    QTreeWidget *m_hostView;
+    QTreeWidget *m_fileView;
+};
+
+#endif
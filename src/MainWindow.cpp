@@ -22,6 +22,7 @@
 
 // Qt includes
 #include <QApplication>
+#include <QtCore/QEvent>
 #include <QtCore/QStringBuilder>
 #include <QtCore/QTimer>
 #include <QSplitter>
@@ -44,6 +45,11 @@
 #include <QApt/Transaction>
 
 // Own includes
+#include "muonapt/AppStreamIcons.h"
+#include "muonapt/ChangelogCache.h"
+#include "muonapt/ContentsIndex.h"
+#include "muonapt/DependencyGraph.h"
+#include "muonapt/FileIndex.h"
 #include "muonapt/MuonStrings.h"
 #include "TransactionWidget.h"
 #include "FilterWidget/FilterWidget.h"
@@ -54,14 +60,24 @@
 #include "config/ManagerSettingsDialog.h"
 #include "muonapt/QAptActions.h"
 
+// Milliseconds without user input after startup or a reload before prefetching changelogs
+constexpr int prefetchDelay = 5000;
+
 MainWindow::MainWindow()
     : KXmlGuiWindow()
+    , m_trans(nullptr)
     , m_settingsDialog(nullptr)
     , m_reviewWidget(nullptr)
     , m_transWidget(nullptr)
     , m_reloading(false)
+    , m_prefetchTimer(new QTimer(this))
 
 {
+    m_prefetchTimer->setSingleShot(true);
+    m_prefetchTimer->setInterval(prefetchDelay);
+    connect(m_prefetchTimer, SIGNAL(timeout()), this, SLOT(prefetchChangelogs()));
+    qApp->installEventFilter(this);
+
     initGUI();
     QTimer::singleShot(10, this, SLOT(initObject()));
 }
@@ -140,6 +156,7 @@ void MainWindow::initGUI()
 void MainWindow::initObject()
 {
     QAptActions::self()->setBackend(m_backend);
+    DependencyGraphStore::self()->setBackend(m_backend);
     Q_EMIT backendReady(m_backend);
     connect(m_backend, SIGNAL(packageChanged()),
             this, SLOT(setActionsEnabled()));
@@ -150,6 +167,14 @@ void MainWindow::initObject()
     loadSettings();
     setActionsEnabled();
     m_managerWidget->setFocus();
+
+    // Catch up with packages changed while we were not running
+    FileIndex::self()->update();
+    ContentsIndex::self()->update();
+    AppStreamIcons::self()->load();
+
+    // Leave the startup to the user before going after changelogs
+    m_prefetchTimer->start();
 }
 
 void MainWindow::loadSettings()
@@ -217,6 +242,11 @@ void MainWindow::setupActions()
     updateAction->setEnabled(QAptActions::self()->isConnected());
     connect(QAptActions::self(), SIGNAL(shouldConnect(bool)), updateAction, SLOT(setEnabled(bool)));
 
+    m_exportAction = actionCollection()->addAction(QStringLiteral("export_package_view"));
+    m_exportAction->setIcon(QIcon::fromTheme(QStringLiteral("document-export")));
+    m_exportAction->setText(i18nc("@action Exports the packages shown in the list to a file", "Export Package List..."));
+    connect(m_exportAction, SIGNAL(triggered()), this, SLOT(exportPackages()));
+
     KStandardAction::preferences(this, SLOT(editSettings()), actionCollection());
 
     setActionsEnabled(false);
@@ -224,6 +254,13 @@ void MainWindow::setupActions()
     setupGUI(StandardWindowOption(KXmlGuiWindow::Default & ~KXmlGuiWindow::StatusBar));
 }
 
+void MainWindow::exportPackages()
+{
+    if (m_managerWidget->isVisible()) {
+        m_managerWidget->exportPackages();
+    }
+}
+
 void MainWindow::setFocusSearchEdit()
 {
     if (m_managerWidget->isVisible()) {
@@ -389,6 +426,15 @@ void MainWindow::reload()
     m_managerWidget->setEnabled(true);
 
     m_reloading = false;
+
+    // Installed files may have changed, the index only rereads changed lists
+    FileIndex::self()->update();
+    ContentsIndex::self()->update();
+    // So may the AppStream metadata, if the package lists got updated
+    AppStreamIcons::self()->load();
+
+    // Reloads in quick succession only prefetch once
+    m_prefetchTimer->start();
 }
 
 void MainWindow::setActionsEnabled(bool enabled)
@@ -400,9 +446,12 @@ void MainWindow::setActionsEnabled(bool enabled)
         m_distUpgradeAction->setEnabled(false);
         m_autoRemoveAction->setEnabled(false);
         m_previewAction->setEnabled(false);
+        m_exportAction->setEnabled(false);
         return;
     }
 
+    m_exportAction->setEnabled(true);
+
     int upgradeable = m_backend->packageCount(QApt::Package::Upgradeable);
     bool changesPending = m_backend->areChangesMarked();
     int autoRemoveable = m_backend->packageCount(QApt::Package::IsGarbage);
@@ -468,6 +517,9 @@ void MainWindow::setupTransaction(QApt::Transaction *trans)
     trans->setLocale(QLatin1String(setlocale(LC_MESSAGES, nullptr)));
 
     trans->setDebconfPipe(m_transWidget->pipe());
+
+    // Stay out of the way of the transaction, we prefetch again after the reload
+    ChangelogCache::self()->cancelPrefetch();
     m_transWidget->setTransaction(m_trans);
 
     connect(m_trans, SIGNAL(statusChanged(QApt::TransactionStatus)),
@@ -476,6 +528,41 @@ void MainWindow::setupTransaction(QApt::Transaction *trans)
             this, SLOT(errorOccurred(QApt::ErrorCode)));
 }
 
+void MainWindow::prefetchChangelogs()
+{
+    if (!MuonSettings::self()->prefetchChangelogs() || m_trans || m_reloading) {
+        return;
+    }
+
+    QList<ChangelogRequest> requests;
+    const QApt::PackageList upgradeable = m_backend->upgradeablePackages();
+    for (QApt::Package *package : upgradeable) {
+        requests.append(ChangelogRequest::forPackage(package));
+    }
+
+    ChangelogCache::self()->prefetch(requests);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    // Any input while a prefetch is due puts it off, it should only run
+    // when the user is not around
+    if (m_prefetchTimer->isActive()) {
+        switch (event->type()) {
+        case QEvent::KeyPress:
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseMove:
+        case QEvent::Wheel:
+            m_prefetchTimer->start();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return KXmlGuiWindow::eventFilter(watched, event);
+}
+
 QSize MainWindow::sizeHint() const
 {
     return KXmlGuiWindow::sizeHint().expandedTo(QSize(900, 500));
@@ -26,6 +26,7 @@
 #include <QApt/Globals>
 
 class QSplitter;
+class QTimer;
 class QStackedWidget;
 class QToolBox;
 class KDialog;
@@ -59,6 +60,9 @@ public:
     QSize sizeHint() const Q_DECL_OVERRIDE;
     bool queryClose() Q_DECL_OVERRIDE;
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE;
+
 private:
     QApt::Backend *m_backend;
     QApt::Transaction *m_trans;
@@ -71,6 +75,7 @@ private:
     QAction *m_previewAction;
     QAction *m_applyAction;
     QAction *m_saveInstalledAction;
+    QAction *m_exportAction;
     QAction *m_saveSelectionsAction;
     QAction *m_loadSelectionsAction;
     QAction *m_createDownloadListAction;
@@ -85,6 +90,8 @@ private:
     TransactionWidget *m_transWidget;
     StatusWidget *m_statusWidget;
     bool m_reloading;
+    // Goes off once the user left the application alone for a while
+    QTimer *m_prefetchTimer;
 
 private Q_SLOTS:
     void initGUI();
@@ -106,6 +113,8 @@ private Q_SLOTS:
     void reload();
     void setActionsEnabled(bool enabled = true);
     void downloadArchives(QApt::Transaction *trans);
+    void prefetchChangelogs();
+    void exportPackages();
 
 public Q_SLOTS:
     void revertChanges();
@@ -29,20 +29,51 @@
 #include <KIconLoader>
 
 // Own
+#include "muonapt/AppStreamIcons.h"
 #include "muonapt/MuonStrings.h"
 #include "PackageModel.h"
 
+// Bytes of rendered name cells kept around, enough for a few screens of rows
+constexpr int cachedRowBytes = 16 * 1024 * 1024;
+// Laid out names and descriptions kept around
+constexpr int cachedTextCount = 2048;
+// Elided texts of the other columns kept around
+constexpr int cachedCellCount = 4096;
+// Length of the fade at the end of text that does not fit
+constexpr int fadeLength = 16;
+
+enum RowFlags {
+    SelectedRow = 0x1,
+    PinnedRow = 0x2,
+    RightToLeftRow = 0x4,
+    AppIconRow = 0x8
+};
+
 PackageDelegate::PackageDelegate(QObject *parent)
     : QAbstractItemDelegate(parent)
     , m_icon(QIcon::fromTheme(QStringLiteral("muon")))
     , m_supportedEmblem(QIcon::fromTheme(QStringLiteral("ubuntu-supported")).pixmap(QSize(12,12)))
     , m_lockedEmblem(QIcon::fromTheme(QStringLiteral("object-locked")).pixmap(QSize(12,12)))
+    , m_rows(cachedRowBytes)
+    , m_texts(cachedTextCount)
+    , m_cells(cachedCellCount)
+    , m_colorsPalette(-1)
+    , m_colorsGroup(-1)
+    , m_itemHeight(-1)
+    , m_stateNameWidth(-1)
 {
     m_spacing  = 4;
 
     m_iconSize = KIconLoader::SizeSmallMedium;
 }
 
+void PackageDelegate::clearCache()
+{
+    m_rows.clear();
+    m_texts.clear();
+    m_cells.clear();
+}
+
 void PackageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     if (!index.isValid()) {
@@ -60,10 +91,9 @@ void PackageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &optio
     case 3: // InstalledSize
     case 4: // InstalledVersion
     case 5: // AvailableVersion
+    default: // Optional columns
         paintText(painter, option, index);
         break;
-    default:
-        break;
     }
 }
 
@@ -75,90 +105,179 @@ void PackageDelegate::paintBackground(QPainter *painter, const QStyleOptionViewI
 
 void PackageDelegate::paintPackageName(QPainter *painter, const QStyleOptionViewItem &option , const QModelIndex &index) const
 {
-    int left = option.rect.left();
-    int top = option.rect.top();
-    int width = option.rect.width();
+    const bool pinned = index.data(PackageModel::StatusRole).toInt() & QApt::Package::IsPinned;
+
+    int flags = option.palette.currentColorGroup() << 4;
+    if (option.state.testFlag(QStyle::State_Selected)) {
+        flags |= SelectedRow;
+    }
+    if (pinned) {
+        flags |= PinnedRow;
+    }
+    if (painter->layoutDirection() == Qt::RightToLeft) {
+        flags |= RightToLeftRow;
+    }
+
+    const qreal dpr = painter->device()->devicePixelRatioF();
+
+    // Rows show the generic icon until the application icon is decoded, and
+    // get rendered again once it is
+    QPixmap appIcon;
+    const RowText &text = rowText(option, index);
+    if (AppStreamIcons::self()->hasIcon(text.packageName)) {
+        appIcon = AppStreamIcons::self()->icon(text.packageName, qRound(m_iconSize * dpr));
+        if (!appIcon.isNull()) {
+            appIcon.setDevicePixelRatio(dpr);
+            flags |= AppIconRow;
+        }
+    }
+    const RowKey key = { index.data(PackageModel::PackageIdRole).value<quintptr>(),
+                         option.rect.width(), option.rect.height(), flags,
+                         option.palette.cacheKey(), dpr };
+
+    // Scrolling back and forth or hovering repaints the same rows over and over
+    if (const QPixmap *row = m_rows.object(key)) {
+        painter->drawPixmap(option.rect.topLeft(), *row);
+        return;
+    }
+
+    auto *row = new QPixmap(option.rect.size() * dpr);
+    row->setDevicePixelRatio(dpr);
+    row->fill(Qt::transparent);
+    QPainter p(row);
+    p.setLayoutDirection(painter->layoutDirection());
+    renderPackageName(&p, option, index, QRect(QPoint(0, 0), option.rect.size()), pinned, appIcon);
+    p.end();
+
+    painter->drawPixmap(option.rect.topLeft(), *row);
+    m_rows.insert(key, row, row->width() * row->height() * row->depth() / 8);
+}
+
+const PackageDelegate::RowText &PackageDelegate::rowText(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const quintptr package = index.data(PackageModel::PackageIdRole).value<quintptr>();
+    RowText *text = m_texts.object(package);
+    if (text && text->font == option.font) {
+        return *text;
+    }
+
+    text = new RowText;
+    text->font = option.font;
+    text->packageName = index.data(PackageModel::PackageNameRole).toString();
+    text->name.setTextFormat(Qt::PlainText);
+    text->name.setText(index.data(PackageModel::NameRole).toString());
+    text->name.prepare(QTransform(), option.font);
+    text->description.setTextFormat(Qt::PlainText);
+    text->description.setText(index.data(PackageModel::DescriptionRole).toString());
+    text->description.prepare(QTransform(), option.font);
+    m_texts.insert(package, text);
+    return *text;
+}
+
+const QStaticText &PackageDelegate::cellText(const QStyleOptionViewItem &option, const QModelIndex &index,
+                                             const QString &text) const
+{
+    const CellKey key = { index.data(PackageModel::PackageIdRole).value<quintptr>(), index.column(),
+                          option.rect.width() };
+    CellText *cell = m_cells.object(key);
+    // Versions and states change under the same package, so the text is checked too
+    if (cell && cell->font == option.font && cell->text == text) {
+        return cell->elided;
+    }
+
+    cell = new CellText;
+    cell->font = option.font;
+    cell->text = text;
+    cell->elided.setTextFormat(Qt::PlainText);
+    cell->elided.setText(option.fontMetrics.elidedText(text, option.textElideMode, option.rect.width()));
+    cell->elided.prepare(QTransform(), option.font);
+    m_cells.insert(key, cell);
+    return cell->elided;
+}
+
+void PackageDelegate::renderPackageName(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index,
+                                        const QRect &rect, bool pinned, const QPixmap &appIcon) const
+{
+    int left = rect.left();
+    int top = rect.top();
+    int width = rect.width();
 
     bool leftToRight = (painter->layoutDirection() == Qt::LeftToRight);
 
     QColor foregroundColor = (option.state.testFlag(QStyle::State_Selected)) ?
                              option.palette.color(QPalette::HighlightedText) : option.palette.color(QPalette::Text);
 
-    const qreal dpr = painter->device()->devicePixelRatioF();
+    const QRect iconRect(leftToRight ? left + m_spacing : left + width - m_spacing - m_iconSize,
+                         top + m_spacing,
+                         m_iconSize,
+                         m_iconSize);
+    if (appIcon.isNull()) {
+        m_icon.paint(painter, iconRect, Qt::AlignCenter, QIcon::Normal);
+    } else {
+        QRect appIconRect(QPoint(0, 0), appIcon.deviceIndependentSize().toSize());
+        appIconRect.moveCenter(iconRect.center());
+        painter->drawPixmap(appIconRect, appIcon);
+    }
 
-    // Pixmap that the text/icon goes in
-    QPixmap pixmap(option.rect.size() * dpr);
-    pixmap.setDevicePixelRatio(dpr);
-    pixmap.fill(Qt::transparent);
-    QPainter p(&pixmap);
-    p.translate(-option.rect.topLeft());
-
-    m_icon.paint(&p,
-                 leftToRight ? left + m_spacing : left + width - m_spacing - m_iconSize,
-                 top + m_spacing,
-                 m_iconSize,
-                 m_iconSize,
-                 Qt::AlignCenter,
-                 QIcon::Normal);
-
-    int state = index.data(PackageModel::StatusRole).toInt();
-
-    if (state & QApt::Package::IsPinned) {
-        p.drawPixmap(left + m_iconSize - m_lockedEmblem.width()/2,
-                     top + option.rect.height() - 1.5*m_lockedEmblem.height(),
-                     m_lockedEmblem);
+    if (pinned) {
+        painter->drawPixmap(left + m_iconSize - m_lockedEmblem.width()/2,
+                            top + rect.height() - 1.5*m_lockedEmblem.height(),
+                            m_lockedEmblem);
     } else if (index.data(PackageModel::SupportRole).toBool()) {
-        p.drawPixmap(left + m_iconSize - m_lockedEmblem.width()/2,
-                     top + option.rect.height() - 1.5*m_lockedEmblem.height(),
-                     m_supportedEmblem);
+        painter->drawPixmap(left + m_iconSize - m_lockedEmblem.width()/2,
+                            top + rect.height() - 1.5*m_lockedEmblem.height(),
+                            m_supportedEmblem);
     }
 
     // Text
-    QStyleOptionViewItem name_item(option);
-    QStyleOptionViewItem description_item(option);
-
-    description_item.font.setPointSize(name_item.font.pointSize());
-
+    const RowText &text = rowText(option, index);
     int textInner = 2 * m_spacing + m_iconSize;
     const int itemHeight = calcItemHeight(option);
-
-    p.setPen(foregroundColor);
-    p.drawText(left + (leftToRight ? textInner : 0),
-               top + 1,
-               width - textInner,
-               itemHeight / 2,
-               Qt::AlignBottom | Qt::AlignLeft,
-               index.data(PackageModel::NameRole).toString());
-
-    p.drawText(left + (leftToRight ? textInner : 0) + 10,
-               top + itemHeight / 2,
-               width - textInner,
-               itemHeight / 2,
-               Qt::AlignTop | Qt::AlignLeft,
-               index.data(PackageModel::DescriptionRole).toString());
-
-    QLinearGradient gradient;
-
-    // Gradient part of the background - fading of the text at the end
-    if (leftToRight) {
-        gradient = QLinearGradient(left + width - m_spacing - 16 /*fade length*/, 0,
-                                   left + width - m_spacing, 0);
-        gradient.setColorAt(0, Qt::white);
-        gradient.setColorAt(1, Qt::transparent);
+    const int textLeft = left + (leftToRight ? textInner : 0);
+    const QRect textRect(textLeft, top, width - textInner, rect.height());
+
+    // Text that does not fit fades out, by drawing it with a gradient pen
+    // rather than compositing a mask over it
+    const bool overflows = qMax(text.name.size().width(), text.description.size().width() + 10) > textRect.width();
+    if (overflows) {
+        QLinearGradient gradient;
+        QColor transparent = foregroundColor;
+        transparent.setAlpha(0);
+        if (leftToRight) {
+            gradient = QLinearGradient(left + width - m_spacing - fadeLength, 0, left + width - m_spacing, 0);
+            gradient.setColorAt(0, foregroundColor);
+            gradient.setColorAt(1, transparent);
+        } else {
+            gradient = QLinearGradient(left + m_spacing, 0, left + m_spacing + fadeLength, 0);
+            gradient.setColorAt(0, transparent);
+            gradient.setColorAt(1, foregroundColor);
+        }
+        painter->setPen(QPen(QBrush(gradient), 0));
     } else {
-        gradient = QLinearGradient(left + m_spacing, 0,
-                                   left + m_spacing + 16, 0);
-        gradient.setColorAt(0, Qt::transparent);
-        gradient.setColorAt(1, Qt::white);
+        painter->setPen(foregroundColor);
     }
 
-    QRect paintRect = option.rect;
-    p.setCompositionMode(QPainter::CompositionMode_DestinationIn);
-    p.fillRect(paintRect, gradient);
+    painter->save();
+    painter->setClipRect(textRect);
+    // The name sits on the middle of the row, the description hangs from it
+    painter->drawStaticText(textLeft, top + 1 + itemHeight / 2 - qRound(text.name.size().height()), text.name);
+    painter->drawStaticText(textLeft + 10, top + itemHeight / 2, text.description);
+    painter->restore();
+}
 
-    p.end();
+void PackageDelegate::updateColors(const QPalette &palette) const
+{
+    if (palette.cacheKey() == m_colorsPalette && palette.currentColorGroup() == m_colorsGroup) {
+        return;
+    }
 
-    painter->drawPixmap(option.rect.topLeft(), pixmap);
+    KColorScheme color(palette.currentColorGroup());
+    m_negativeBrush = color.foreground(KColorScheme::NegativeText);
+    m_positiveBrush = color.foreground(KColorScheme::PositiveText);
+    m_neutralBrush = color.foreground(KColorScheme::NeutralText);
+    m_linkBrush = color.foreground(KColorScheme::LinkText);
+    m_colorsPalette = palette.cacheKey();
+    m_colorsGroup = palette.currentColorGroup();
 }
 
 void PackageDelegate::paintText(QPainter *painter, const QStyleOptionViewItem &option , const QModelIndex &index) const
@@ -166,7 +285,7 @@ void PackageDelegate::paintText(QPainter *painter, const QStyleOptionViewItem &o
     int state;
     QString text;
     QPen pen;
-    KColorScheme color(option.palette.currentColorGroup());
+    updateColors(option.palette);
 
     QColor foregroundColor = (option.state.testFlag(QStyle::State_Selected)) ?
                              option.palette.color(QPalette::HighlightedText) : option.palette.color(QPalette::Text);
@@ -177,21 +296,21 @@ void PackageDelegate::paintText(QPainter *painter, const QStyleOptionViewItem &o
 
         if (state & QApt::Package::NowBroken) {
             text = MuonStrings::global()->packageStateName(QApt::Package::NowBroken);
-            pen.setBrush(color.foreground(KColorScheme::NegativeText));
+            pen.setBrush(m_negativeBrush);
             break;
         }
 
         if (state & QApt::Package::Installed) {
             text = MuonStrings::global()->packageStateName(QApt::Package::Installed);
-            pen.setBrush(color.foreground(KColorScheme::PositiveText));
+            pen.setBrush(m_positiveBrush);
 
             if (state & QApt::Package::Upgradeable) {
                 text = MuonStrings::global()->packageStateName(QApt::Package::Upgradeable);
-                pen.setBrush(color.foreground(KColorScheme::LinkText));
+                pen.setBrush(m_linkBrush);
             }
         } else {
             text = MuonStrings::global()->packageStateName(QApt::Package::NotInstalled);
-            pen.setBrush(color.foreground(KColorScheme::NeutralText));
+            pen.setBrush(m_neutralBrush);
         }
         break;
     case 2:
@@ -199,42 +318,42 @@ void PackageDelegate::paintText(QPainter *painter, const QStyleOptionViewItem &o
 
         if (state & QApt::Package::ToKeep) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToKeep);
-            pen.setBrush(color.foreground(KColorScheme::NeutralText));
+            pen.setBrush(m_neutralBrush);
             // No other "To" flag will be set if we are keeping
             break;
         }
 
         if (state & QApt::Package::ToInstall) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToInstall);
-            pen.setBrush(color.foreground(KColorScheme::PositiveText));
+            pen.setBrush(m_positiveBrush);
         }
 
         if (state & QApt::Package::ToUpgrade) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToUpgrade);
-            pen.setBrush(color.foreground(KColorScheme::LinkText));
+            pen.setBrush(m_linkBrush);
             break;
         }
 
         if (state & QApt::Package::ToRemove) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToRemove);
-            pen.setBrush(color.foreground(KColorScheme::NegativeText));
+            pen.setBrush(m_negativeBrush);
         }
 
         if (state & QApt::Package::ToPurge) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToPurge);
-            pen.setBrush(color.foreground(KColorScheme::NegativeText));
+            pen.setBrush(m_negativeBrush);
             break;
         }
 
         if (state & QApt::Package::ToReInstall) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToReInstall);
-            pen.setBrush(color.foreground(KColorScheme::PositiveText));
+            pen.setBrush(m_positiveBrush);
             break;
         }
 
         if (state & QApt::Package::ToDowngrade) {
             text = MuonStrings::global()->packageStateName(QApt::Package::ToDowngrade);
-            pen.setBrush(color.foreground(KColorScheme::LinkText));
+            pen.setBrush(m_linkBrush);
             break;
         }
         break;
@@ -250,35 +369,35 @@ void PackageDelegate::paintText(QPainter *painter, const QStyleOptionViewItem &o
         text = index.data(PackageModel::AvailableVersionRole).toString();
         pen.setBrush(foregroundColor);
         break;
+    default:
+        text = index.data(Qt::DisplayRole).toString();
+        pen.setBrush(foregroundColor);
+        break;
     }
 
-    QFont font = option.font;
-    QFontMetrics fontMetrics(font);
+    const QFontMetrics &fontMetrics = option.fontMetrics;
 
     int x = option.rect.x() + m_spacing;
     int y = option.rect.y() + calcItemHeight(option) / 4 + fontMetrics.height() -1;
-    int width = option.rect.width();
 
     painter->setPen(pen);
-    painter->drawText(x, y, fontMetrics.elidedText(text, option.textElideMode, width));
+    // Static text is positioned by its top rather than its baseline
+    painter->drawStaticText(x, y - fontMetrics.ascent(), cellText(option, index, text));
 }
 
 QSize PackageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
-    Q_UNUSED(index);
-
     QSize size;
-    QFontMetrics metric = QFontMetrics(option.font);
+    const QFontMetrics &metric = option.fontMetrics;
 
     switch (index.column()) {
     case 0:
         size.setWidth(metric.horizontalAdvance(index.data(PackageModel::DescriptionRole).toString()));
         break;
     case 1:
-        size.setWidth(metric.horizontalAdvance(index.data(PackageModel::StatusRole).toString()));
-        break;
     case 2:
-        size.setWidth(metric.horizontalAdvance(index.data(PackageModel::ActionRole).toString()));
+        // Only ever one of a handful of state names, no need to look at the row
+        size.setWidth(stateNameWidth(option));
         break;
     case 3:
         size.setWidth(metric.horizontalAdvance(index.data(PackageModel::InstalledSizeDisplayRole).toString()));
@@ -290,6 +409,7 @@ QSize PackageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModel
         size.setWidth(metric.horizontalAdvance(index.data(PackageModel::AvailableVersionRole).toString()));
         break;
     default:
+        size.setWidth(metric.horizontalAdvance(index.data(Qt::DisplayRole).toString()));
         break;
     }
     size.setHeight(option.fontMetrics.height() * 2 + m_spacing);
@@ -297,8 +417,37 @@ QSize PackageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModel
     return size;
 }
 
+int PackageDelegate::stateNameWidth(const QStyleOptionViewItem &option) const
+{
+    if (m_stateNameWidth >= 0 && option.font == m_stateNameFont) {
+        return m_stateNameWidth;
+    }
+
+    // Every state paintText() may show in the status and action columns
+    static const QApt::Package::State states[] = {
+        QApt::Package::NowBroken, QApt::Package::Installed, QApt::Package::Upgradeable,
+        QApt::Package::NotInstalled, QApt::Package::ToKeep, QApt::Package::ToInstall,
+        QApt::Package::ToUpgrade, QApt::Package::ToRemove, QApt::Package::ToPurge,
+        QApt::Package::ToReInstall, QApt::Package::ToDowngrade
+    };
+
+    m_stateNameWidth = 0;
+    for (QApt::Package::State state : states) {
+        const QString name = MuonStrings::global()->packageStateName(state);
+        m_stateNameWidth = qMax(m_stateNameWidth, option.fontMetrics.horizontalAdvance(name));
+    }
+    m_stateNameFont = option.font;
+
+    return m_stateNameWidth;
+}
+
 int PackageDelegate::calcItemHeight(const QStyleOptionViewItem &option) const
 {
+    // Every cell asks for this, and it only changes with the font
+    if (m_itemHeight >= 0 && option.font == m_itemHeightFont) {
+        return m_itemHeight;
+    }
+
     // Painting main column
     QStyleOptionViewItem name_item(option);
     QStyleOptionViewItem description_item(option);
@@ -306,5 +455,7 @@ int PackageDelegate::calcItemHeight(const QStyleOptionViewItem &option) const
     description_item.font.setPointSize(name_item.font.pointSize());
 
     int textHeight = QFontInfo(name_item.font).pixelSize() + QFontInfo(description_item.font).pixelSize();
-    return qMax(textHeight, m_iconSize) + 2 * m_spacing;
+    m_itemHeightFont = option.font;
+    m_itemHeight = qMax(textHeight, m_iconSize) + 2 * m_spacing;
+    return m_itemHeight;
 }
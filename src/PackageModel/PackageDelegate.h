@@ -23,7 +23,11 @@
 
 #include <QAbstractItemDelegate>
 
+#include <QtCore/QCache>
+#include <QBrush>
+#include <QFont>
 #include <QIcon>
+#include <QStaticText>
 
 class PackageDelegate: public QAbstractItemDelegate
 {
@@ -31,6 +35,9 @@ class PackageDelegate: public QAbstractItemDelegate
 public:
     explicit PackageDelegate(QObject *parent = nullptr);
 
+    /** Drops cached rows. They refer to packages by address, so this must follow every cache reload */
+    void clearCache();
+
 protected:
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintBackground(QPainter *painter, const QStyleOptionViewItem &option) const;
@@ -40,6 +47,58 @@ protected:
     QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
 
 private:
+    // What a rendered name cell depends on
+    struct RowKey {
+        quintptr package;
+        int width;
+        int height;
+        int flags;
+        qint64 palette;
+        qreal devicePixelRatio;
+
+        bool operator==(const RowKey &other) const
+        {
+            return package == other.package && width == other.width && height == other.height
+                    && flags == other.flags && palette == other.palette
+                    && devicePixelRatio == other.devicePixelRatio;
+        }
+    };
+    friend size_t qHash(const RowKey &key, size_t seed)
+    {
+        return qHashMulti(seed, key.package, key.width, key.height, key.flags, key.palette);
+    }
+
+    // Laid out name and description of a package
+    struct RowText {
+        QFont font;
+        QString packageName;
+        QStaticText name;
+        QStaticText description;
+    };
+
+    // Where an elided text cell is shown
+    struct CellKey {
+        quintptr package;
+        int column;
+        int width;
+
+        bool operator==(const CellKey &other) const
+        {
+            return package == other.package && column == other.column && width == other.width;
+        }
+    };
+    friend size_t qHash(const CellKey &key, size_t seed)
+    {
+        return qHashMulti(seed, key.package, key.column, key.width);
+    }
+
+    // Laid out text of a cell, elided to the width of its column
+    struct CellText {
+        QFont font;
+        QString text;
+        QStaticText elided;
+    };
+
     int m_iconSize;
     int m_spacing;
 
@@ -47,7 +106,30 @@ private:
     QPixmap m_supportedEmblem;
     QPixmap m_lockedEmblem;
 
+    mutable QCache<RowKey, QPixmap> m_rows;
+    mutable QCache<quintptr, RowText> m_texts;
+    mutable QCache<CellKey, CellText> m_cells;
+
+    // Status colors of the palette last painted with
+    mutable qint64 m_colorsPalette;
+    mutable int m_colorsGroup;
+    mutable QBrush m_negativeBrush;
+    mutable QBrush m_positiveBrush;
+    mutable QBrush m_neutralBrush;
+    mutable QBrush m_linkBrush;
+
+    mutable QFont m_itemHeightFont;
+    mutable int m_itemHeight;
+    mutable QFont m_stateNameFont;
+    mutable int m_stateNameWidth;
+
     int calcItemHeight(const QStyleOptionViewItem &option) const;
+    int stateNameWidth(const QStyleOptionViewItem &option) const;
+    const RowText &rowText(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    const QStaticText &cellText(const QStyleOptionViewItem &option, const QModelIndex &index, const QString &text) const;
+    void renderPackageName(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index,
+                           const QRect &rect, bool pinned, const QPixmap &appIcon) const;
+    void updateColors(const QPalette &palette) const;
 };
 
 #endif
@@ -0,0 +1,438 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "PackageExporter.h"
+
+// Qt includes
+#include <QtConcurrentRun>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimer>
+#include <QtCore/QWaitCondition>
+
+// Own includes
+#include "muonapt/MuonStrings.h"
+#include "PackageModel.h"
+
+// Output is handed to the file whenever this much of it piled up
+constexpr int chunkSize = 64 * 1024;
+// Rows handed to the worker at once
+constexpr int batchRows = 2000;
+// Batches that may wait for the worker before formatting pauses
+constexpr int maxQueuedBatches = 4;
+// Milliseconds spent formatting rows per event loop iteration
+constexpr int formatSliceTime = 4;
+// Milliseconds between checks whether the worker caught up
+constexpr int queueWaitTime = 10;
+
+// Rows formatted on the GUI thread on their way to the worker
+struct ExportQueue
+{
+    QMutex mutex;
+    QWaitCondition changed;
+    QQueue<QStringList> batches;
+    bool complete = false;
+    bool canceled = false;
+};
+
+// Same precedence as the status and requested columns of PackageDelegate
+static QString statusText(int state)
+{
+    if (state & QApt::Package::NowBroken) {
+        return MuonStrings::global()->packageStateName(QApt::Package::NowBroken);
+    }
+    if (state & QApt::Package::Upgradeable) {
+        return MuonStrings::global()->packageStateName(QApt::Package::Upgradeable);
+    }
+    if (state & QApt::Package::Installed) {
+        return MuonStrings::global()->packageStateName(QApt::Package::Installed);
+    }
+    return MuonStrings::global()->packageStateName(QApt::Package::NotInstalled);
+}
+
+static QString requestedText(int state)
+{
+    static const QApt::Package::State changes[] = {
+        QApt::Package::ToKeep, QApt::Package::ToUpgrade, QApt::Package::ToPurge,
+        QApt::Package::ToReInstall, QApt::Package::ToDowngrade, QApt::Package::ToRemove,
+        QApt::Package::ToInstall
+    };
+    for (QApt::Package::State change : changes) {
+        if (state & change) {
+            return MuonStrings::global()->packageStateName(change);
+        }
+    }
+    return QString();
+}
+
+// Keys of the JSON objects, which unlike the column titles are not translated
+static QLatin1String jsonKey(int column)
+{
+    switch (column) {
+    case PackageModel::NameColumn:
+        return QLatin1String("package");
+    case PackageModel::StatusColumn:
+        return QLatin1String("status");
+    case PackageModel::ActionColumn:
+        return QLatin1String("requested");
+    case PackageModel::InstalledSizeColumn:
+        return QLatin1String("installed_size");
+    case PackageModel::InstalledVersionColumn:
+        return QLatin1String("installed_version");
+    case PackageModel::AvailableVersionColumn:
+        return QLatin1String("available_version");
+    case PackageModel::DownloadSizeColumn:
+        return QLatin1String("download_size");
+    case PackageModel::OriginColumn:
+        return QLatin1String("origin");
+    case PackageModel::ComponentColumn:
+        return QLatin1String("component");
+    case PackageModel::SectionColumn:
+        return QLatin1String("section");
+    case PackageModel::MaintainerColumn:
+        return QLatin1String("maintainer");
+    case PackageModel::SourcePackageColumn:
+        return QLatin1String("source_package");
+    case PackageModel::SupportEndColumn:
+        return QLatin1String("supported_until");
+    }
+    return QLatin1String("column");
+}
+
+static bool isSizeColumn(int column)
+{
+    return column == PackageModel::InstalledSizeColumn || column == PackageModel::DownloadSizeColumn;
+}
+
+// Sizes are written in bytes, so that they can be added up
+static QString columnText(QApt::Package *package, int column)
+{
+    switch (column) {
+    case PackageModel::NameColumn:
+        return package->isForeignArch() ? package->name() + QLatin1Char(':') + package->architecture()
+                                        : package->name();
+    case PackageModel::StatusColumn:
+        return statusText(package->state());
+    case PackageModel::ActionColumn:
+        return requestedText(package->state());
+    case PackageModel::InstalledSizeColumn:
+        return package->installedSize() < 0 ? QString() : QString::number(package->installedSize());
+    case PackageModel::InstalledVersionColumn:
+        return package->installedVersion();
+    case PackageModel::AvailableVersionColumn:
+        return package->availableVersion();
+    case PackageModel::DownloadSizeColumn:
+        return QString::number(package->downloadSize());
+    case PackageModel::OriginColumn:
+        return package->origin();
+    case PackageModel::ComponentColumn:
+        return package->component();
+    case PackageModel::SectionColumn:
+        return package->section();
+    case PackageModel::MaintainerColumn:
+        return package->maintainer();
+    case PackageModel::SourcePackageColumn:
+        return package->sourcePackage();
+    case PackageModel::SupportEndColumn:
+        return package->isSupported() ? package->supportedUntil().date().toString(Qt::ISODate) : QString();
+    }
+    return QString();
+}
+
+static void appendCsvField(QByteArray *out, const QString &text)
+{
+    const QByteArray field = text.toUtf8();
+    if (!field.contains(',') && !field.contains('"') && !field.contains('\n') && !field.contains('\r')) {
+        out->append(field);
+        return;
+    }
+
+    out->append('"');
+    for (char c : field) {
+        if (c == '"') {
+            out->append('"');
+        }
+        out->append(c);
+    }
+    out->append('"');
+}
+
+static void appendJsonString(QByteArray *out, const QString &text)
+{
+    const QByteArray string = text.toUtf8();
+    out->append('"');
+    for (char c : string) {
+        switch (c) {
+        case '"':
+            out->append("\\\"");
+            break;
+        case '\\':
+            out->append("\\\\");
+            break;
+        case '\n':
+            out->append("\\n");
+            break;
+        case '\r':
+            out->append("\\r");
+            break;
+        case '\t':
+            out->append("\\t");
+            break;
+        default:
+            if (uchar(c) < 0x20) {
+                out->append("\\u00");
+                out->append(QByteArray::number(uchar(c), 16).rightJustified(2, '0'));
+            } else {
+                out->append(c);
+            }
+        }
+    }
+    out->append('"');
+}
+
+PackageExporter::PackageExporter(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<QString>(this))
+    , m_formatTimer(new QTimer(this))
+    , m_format(CsvFormat)
+    , m_formattedRows(0)
+{
+    m_formatTimer->setInterval(0);
+    connect(m_formatTimer, &QTimer::timeout, this, &PackageExporter::formatMoreRows);
+    connect(m_watcher, &QFutureWatcher<QString>::finished, this, &PackageExporter::exportFinished);
+    connect(m_watcher, &QFutureWatcher<QString>::progressValueChanged, this, &PackageExporter::progressValueChanged);
+}
+
+bool PackageExporter::isRunning() const
+{
+    return m_formatTimer->isActive() || m_watcher->isRunning();
+}
+
+void PackageExporter::start(const QApt::PackageList &packages, const QVector<int> &columns, const QStringList &titles,
+                            const QString &fileName, Format format)
+{
+    cancelAndWait();
+
+    m_packages = packages;
+    m_columns = columns;
+    m_titles = titles;
+    m_fileName = fileName;
+    m_format = format;
+    m_batch.clear();
+    m_formattedRows = 0;
+    m_queue.reset(new ExportQueue);
+
+    // Progress counts the rows written, not the ones formatted
+    Q_EMIT progressRangeChanged(0, packages.size());
+    m_watcher->setFuture(QtConcurrent::run(&PackageExporter::write, m_queue, int(packages.size()), m_columns, m_titles,
+                                           m_fileName, m_format));
+    m_formatTimer->setInterval(0);
+    m_formatTimer->start();
+}
+
+void PackageExporter::formatMoreRows()
+{
+    {
+        QMutexLocker locker(&m_queue->mutex);
+        if (m_queue->batches.size() >= maxQueuedBatches) {
+            // The worker is behind, don't pile up more text than it has to chew on
+            m_formatTimer->setInterval(queueWaitTime);
+            return;
+        }
+    }
+    m_formatTimer->setInterval(0);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    const int batchCells = batchRows * m_columns.size();
+    while (m_formattedRows < m_packages.size() && elapsed.elapsed() < formatSliceTime) {
+        QApt::Package *package = m_packages.at(m_formattedRows++);
+        for (int column : std::as_const(m_columns)) {
+            m_batch.append(columnText(package, column));
+        }
+
+        if (m_batch.size() >= batchCells && !queueBatch()) {
+            break;
+        }
+    }
+
+    if (m_formattedRows < m_packages.size()) {
+        return;
+    }
+
+    m_formatTimer->stop();
+    // The worker gets nothing but text, the packages may change meanwhile
+    m_packages.clear();
+    queueBatch();
+
+    QMutexLocker locker(&m_queue->mutex);
+    m_queue->complete = true;
+    m_queue->changed.wakeAll();
+}
+
+// Hands the rows formatted so far to the worker, and returns whether it can take more
+bool PackageExporter::queueBatch()
+{
+    QMutexLocker locker(&m_queue->mutex);
+    if (!m_batch.isEmpty()) {
+        m_queue->batches.enqueue(m_batch);
+        m_queue->changed.wakeAll();
+        m_batch.clear();
+    }
+
+    return m_queue->batches.size() < maxQueuedBatches;
+}
+
+void PackageExporter::cancel()
+{
+    m_formatTimer->stop();
+    m_packages.clear();
+    m_batch.clear();
+    if (m_queue) {
+        QMutexLocker locker(&m_queue->mutex);
+        m_queue->canceled = true;
+        m_queue->batches.clear();
+        m_queue->changed.wakeAll();
+    }
+    m_watcher->cancel();
+}
+
+void PackageExporter::cancelAndWait()
+{
+    cancel();
+    m_watcher->waitForFinished();
+}
+
+void PackageExporter::exportFinished()
+{
+    // The worker may have given up on an error before all rows were formatted
+    m_formatTimer->stop();
+    m_packages.clear();
+    m_batch.clear();
+    m_queue.reset();
+
+    if (m_watcher->isCanceled()) {
+        return;
+    }
+
+    Q_EMIT finished(m_fileName, m_watcher->future().resultCount() ? m_watcher->result() : QString());
+}
+
+void PackageExporter::write(QPromise<QString> &promise, const QSharedPointer<ExportQueue> &queue, int rowCount,
+                            const QVector<int> &columns, const QStringList &titles, const QString &fileName, Format format)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        promise.addResult(file.errorString());
+        return;
+    }
+
+    promise.setProgressRange(0, rowCount);
+
+    QByteArray out;
+    out.reserve(chunkSize + 4096);
+
+    if (format == CsvFormat) {
+        for (int i = 0; i < titles.size(); ++i) {
+            if (i > 0) {
+                out.append(',');
+            }
+            appendCsvField(&out, titles.at(i));
+        }
+        out.append('\n');
+    } else {
+        out.append("[\n");
+    }
+
+    int row = 0;
+    while (true) {
+        QStringList cells;
+        {
+            QMutexLocker locker(&queue->mutex);
+            while (queue->batches.isEmpty() && !queue->complete && !queue->canceled) {
+                queue->changed.wait(&queue->mutex);
+            }
+            if (queue->canceled) {
+                file.cancelWriting();
+                return;
+            }
+            if (queue->batches.isEmpty()) {
+                break;
+            }
+            cells = queue->batches.dequeue();
+        }
+
+        for (int cell = 0; cell < cells.size(); ++row) {
+            if (format == CsvFormat) {
+                for (int i = 0; i < columns.size(); ++i) {
+                    if (i > 0) {
+                        out.append(',');
+                    }
+                    appendCsvField(&out, cells.at(cell++));
+                }
+                out.append('\n');
+            } else {
+                out.append(row > 0 ? ",\n  {" : "  {");
+                for (int i = 0; i < columns.size(); ++i) {
+                    const int column = columns.at(i);
+                    const QString &text = cells.at(cell++);
+                    if (i > 0) {
+                        out.append(", ");
+                    }
+                    out.append('"').append(jsonKey(column).data()).append("\": ");
+                    if (isSizeColumn(column)) {
+                        out.append(text.isEmpty() ? QByteArray("null") : text.toLatin1());
+                    } else {
+                        appendJsonString(&out, text);
+                    }
+                }
+                out.append('}');
+            }
+
+            if (out.size() >= chunkSize) {
+                if (file.write(out) < 0) {
+                    promise.addResult(file.errorString());
+                    file.cancelWriting();
+                    return;
+                }
+                out.clear();
+            }
+        }
+
+        if (promise.isCanceled()) {
+            file.cancelWriting();
+            return;
+        }
+        promise.setProgressValue(row);
+    }
+
+    if (format == JsonFormat) {
+        out.append(row ? "\n]\n" : "]\n");
+    }
+
+    if (file.write(out) < 0 || !file.commit()) {
+        promise.addResult(file.errorString());
+        return;
+    }
+
+    promise.setProgressValue(rowCount);
+    promise.addResult(QString());
+}
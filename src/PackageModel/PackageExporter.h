@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef PACKAGEEXPORTER_H
+#define PACKAGEEXPORTER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QPromise>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QFutureWatcher>
+
+class QTimer;
+
+struct ExportQueue;
+
+#include <QApt/Package>
+
+/**
+ * Writes a list of packages with some of their PackageModel columns to a CSV
+ * or JSON file.
+ *
+ * Package data is not thread safe, so the cell texts are read on the GUI
+ * thread, a few milliseconds at a time. Only those texts go to the worker
+ * thread that encodes and writes them, in batches of rows that are freed once
+ * written. The file only replaces an existing one once it is complete.
+ */
+class PackageExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum Format {
+        CsvFormat,
+        JsonFormat
+    };
+
+    explicit PackageExporter(QObject *parent = nullptr);
+
+    bool isRunning() const;
+    /**
+     * Starts writing @p packages to @p fileName. @p columns are PackageModel
+     * columns, and @p titles their titles for the CSV header line.
+     */
+    void start(const QApt::PackageList &packages, const QVector<int> &columns, const QStringList &titles,
+               const QString &fileName, Format format);
+
+public Q_SLOTS:
+    /** Stops the export, leaving any existing file alone */
+    void cancel();
+    /** Cancels the export, and waits for the worker in case it is writing already */
+    void cancelAndWait();
+
+Q_SIGNALS:
+    void progressRangeChanged(int minimum, int maximum);
+    void progressValueChanged(int value);
+    /** Emitted when an export is done, with the error if it failed */
+    void finished(const QString &fileName, const QString &errorString);
+
+private Q_SLOTS:
+    void formatMoreRows();
+    void exportFinished();
+
+private:
+    QFutureWatcher<QString> *m_watcher;
+    QTimer *m_formatTimer;
+    QApt::PackageList m_packages;
+    QVector<int> m_columns;
+    QStringList m_titles;
+    QString m_fileName;
+    Format m_format;
+    // Batches handed to the worker, shared with it
+    QSharedPointer<ExportQueue> m_queue;
+    // Texts of the rows formatted since the last batch, one column after the other
+    QStringList m_batch;
+    int m_formattedRows;
+
+    bool queueBatch();
+    static void write(QPromise<QString> &promise, const QSharedPointer<ExportQueue> &queue, int rowCount,
+                      const QVector<int> &columns, const QStringList &titles, const QString &fileName, Format format);
+};
+
+#endif
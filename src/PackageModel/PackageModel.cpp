@@ -22,6 +22,8 @@
 
 #include <QStringBuilder>
 #include <QIcon>
+#include <QDateTime>
+#include <QLocale>
 #include <KLocalizedString>
 #include <KFormat>
 
@@ -38,7 +40,7 @@ int PackageModel::rowCount(const QModelIndex & /*parent*/) const
 
 int PackageModel::columnCount(const QModelIndex & /*parent*/) const
 {
-    return 6;
+    return ColumnCount;
 }
 
 QVariant PackageModel::data(const QModelIndex &index, int role) const
@@ -63,6 +65,12 @@ QVariant PackageModel::data(const QModelIndex &index, int role) const
         return package->state();
     case SupportRole:
         return package->isSupported();
+    case PackageNameRole:
+        // Unlike NameRole, without the architecture of foreign packages
+        return package->name();
+    case PackageIdRole:
+        // Identifies the package for caches, valid until the next cache reload
+        return QVariant::fromValue(quintptr(package));
     case InstalledSizeRole:
         return package->installedSize();
     case InstalledSizeDisplayRole:
@@ -77,6 +85,24 @@ QVariant PackageModel::data(const QModelIndex &index, int role) const
         return package->installedVersion();
     case AvailableVersionRole:
         return package->availableVersion();
+    case ColumnValueRole:
+        if (index.column() >= DownloadSizeColumn) {
+            return columnValue(index.row(), index.column());
+        }
+        break;
+    case Qt::DisplayRole:
+        if (index.column() >= DownloadSizeColumn) {
+            const QVariant value = columnValue(index.row(), index.column());
+            switch (index.column()) {
+            case DownloadSizeColumn:
+                return KFormat().formatByteSize(value.toLongLong());
+            case SupportEndColumn:
+                return QLocale().toString(value.toDate(), QLocale::ShortFormat);
+            default:
+                return value;
+            }
+        }
+        break;
     case Qt::ToolTipRole:
         return QVariant();
     }
@@ -84,6 +110,50 @@ QVariant PackageModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
+QVariant PackageModel::columnValue(int row, int column) const
+{
+    QVector<QVariant> &values = m_columnValues[column];
+    if (values.isEmpty()) {
+        values.resize(m_packages.size());
+    }
+
+    QVariant &value = values[row];
+    if (!value.isValid()) {
+        value = computeColumnValue(m_packages.at(row), column);
+    }
+
+    return value;
+}
+
+QVariant PackageModel::computeColumnValue(QApt::Package *package, int column)
+{
+    // Every value is a valid QVariant, even when empty, so it is only computed once
+    switch (column) {
+    case DownloadSizeColumn:
+        return package->downloadSize();
+    case OriginColumn:
+        return package->origin();
+    case ComponentColumn:
+        return package->component();
+    case SectionColumn:
+        return package->section();
+    case MaintainerColumn:
+        return package->maintainer();
+    case SourcePackageColumn:
+        return package->sourcePackage();
+    case SupportEndColumn:
+        // Reads the release file of the package's origin, the slowest of the lot
+        return package->isSupported() ? package->supportedUntil().date() : QDate();
+    }
+
+    return QString();
+}
+
+void PackageModel::releaseColumn(int column)
+{
+    m_columnValues.remove(column);
+}
+
 QVariant PackageModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
     Q_UNUSED(orientation);
@@ -101,6 +171,20 @@ QVariant PackageModel::headerData(int section, Qt::Orientation orientation, int
             return QVariant(i18n("Installed Version"));
         case 5:
             return QVariant(i18n("Available Version"));
+        case DownloadSizeColumn:
+            return QVariant(i18n("Download Size"));
+        case OriginColumn:
+            return QVariant(i18n("Origin"));
+        case ComponentColumn:
+            return QVariant(i18n("Component"));
+        case SectionColumn:
+            return QVariant(i18n("Section"));
+        case MaintainerColumn:
+            return QVariant(i18n("Maintainer"));
+        case SourcePackageColumn:
+            return QVariant(i18n("Source Package"));
+        case SupportEndColumn:
+            return QVariant(i18n("Supported Until"));
         }
     }
     return QVariant();
@@ -110,6 +194,7 @@ void PackageModel::setPackages(const QApt::PackageList &list)
 {
     beginResetModel();
     m_packages = list;
+    m_columnValues.clear();
     endResetModel();
 }
 
@@ -117,6 +202,7 @@ void PackageModel::clear()
 {
     beginRemoveRows(QModelIndex(), 0, m_packages.size() - 1);
     m_packages.clear();
+    m_columnValues.clear();
     endRemoveRows();
 }
 
@@ -124,7 +210,10 @@ void PackageModel::externalDataChanged()
 {
     // A package being changed means that any number of other packages can have
     // changed, so say everything changed to trigger refreshes.
-    Q_EMIT dataChanged(index(0, 0), index(m_packages.size() - 1, 0));
+    // Marks may change the candidate version, and with it the sizes, origin
+    // and the like of the optional columns
+    m_columnValues.clear();
+    Q_EMIT dataChanged(index(0, 0), index(m_packages.size() - 1, ColumnCount - 1));
 }
 
 QApt::Package *PackageModel::packageAt(const QModelIndex &index) const
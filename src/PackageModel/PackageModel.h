@@ -22,6 +22,8 @@
 #define PACKAGEMODEL_H
 
 #include <QAbstractListModel>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
 
 #include <QApt/Package>
 
@@ -39,7 +41,27 @@ public:
         InstalledSizeRole = Qt::UserRole + 6,
         InstalledSizeDisplayRole = Qt::UserRole + 7,
         InstalledVersionRole = Qt::UserRole + 8,
-        AvailableVersionRole = Qt::UserRole + 9
+        AvailableVersionRole = Qt::UserRole + 9,
+        PackageIdRole = Qt::UserRole + 10,
+        ColumnValueRole = Qt::UserRole + 11,
+        PackageNameRole = Qt::UserRole + 12
+    };
+    enum Columns {
+        NameColumn = 0,
+        StatusColumn,
+        ActionColumn,
+        InstalledSizeColumn,
+        InstalledVersionColumn,
+        AvailableVersionColumn,
+        // Optional columns, computed on first use, see releaseColumn()
+        DownloadSizeColumn,
+        OriginColumn,
+        ComponentColumn,
+        SectionColumn,
+        MaintainerColumn,
+        SourcePackageColumn,
+        SupportEndColumn,
+        ColumnCount
     };
     explicit PackageModel(QObject *parent = nullptr);
 
@@ -53,8 +75,17 @@ public:
     QApt::Package *packageAt(const QModelIndex &index) const;
     QApt::PackageList packages() const;
 
+    /** Frees the values cached for optional @p column, e.g. once it got hidden */
+    void releaseColumn(int column);
+
 private:
     QApt::PackageList m_packages;
+    // Values of optional columns by column, then row. Only columns that were
+    // painted or sorted have an entry, and only used rows hold a value
+    mutable QHash<int, QVector<QVariant>> m_columnValues;
+
+    QVariant columnValue(int row, int column) const;
+    static QVariant computeColumnValue(QApt::Package *package, int column);
 
 public Q_SLOTS:
     void externalDataChanged();
@@ -20,6 +20,13 @@
 
 #include "PackageProxyModel.h"
 
+// Qt includes
+#include <QtCore/QDate>
+#include <QtCore/QHash>
+
+#include <algorithm>
+#include <numeric>
+
 // KDE includes
 #include <KLocalizedString>
 
@@ -27,6 +34,8 @@
 #include <QApt/Backend>
 
 // Own includes
+#include "muonapt/ContentsIndex.h"
+#include "muonapt/FileIndex.h"
 #include "PackageModel.h"
 #include "MuonSettings.h"
 
@@ -35,11 +44,6 @@ constexpr int status_sort_magic = (QApt::Package::Installed |
                                    QApt::Package::NowBroken |
                                    QApt::Package::New);
 
-bool packageStatusLessThan(QApt::Package *p1, QApt::Package *p2)
-{
-    return (p1->state() & (status_sort_magic))  <
-           (p2->state() & (status_sort_magic));
-}
 
 constexpr int requested_sort_magic = (QApt::Package::ToInstall
                                          | QApt::Package::ToUpgrade
@@ -49,10 +53,55 @@ constexpr int requested_sort_magic = (QApt::Package::ToInstall
                                          | QApt::Package::ToDowngrade
                                          | QApt::Package::ToKeep);
 
-bool packageRequestedLessThan(QApt::Package *p1, QApt::Package *p2)
+// Where the relevancy keys are kept among those of the columns
+constexpr int relevancyKeys = -1;
+
+// Maps a signed value to an unsigned one with the same order
+static quint64 signedSortKey(qint64 value)
 {
-    return (p1->state() & (requested_sort_magic))  <
-           (p2->state() & (requested_sort_magic));
+    return quint64(value) ^ (quint64(1) << 63);
+}
+
+// Dense ranks of @p values, equal values sharing a rank. Every distinct value
+// is only compared once its duplicates are gone, which matters for versions
+static QVector<quint64> stringSortKeys(const QVector<QString> &values, bool versions)
+{
+    QHash<QString, quint64> ranks;
+    ranks.reserve(values.size());
+    for (const QString &value : values) {
+        ranks.insert(value, 0);
+    }
+
+    QVector<QString> distinct;
+    distinct.reserve(ranks.size());
+    for (auto it = ranks.cbegin(); it != ranks.cend(); ++it) {
+        distinct.append(it.key());
+    }
+    if (versions) {
+        std::sort(distinct.begin(), distinct.end(), [](const QString &a, const QString &b) {
+            return QApt::Package::compareVersion(a, b) < 0;
+        });
+    } else {
+        std::sort(distinct.begin(), distinct.end());
+    }
+
+    // Versions that compare equal but are spelled differently share a rank too
+    quint64 rank = 0;
+    for (int i = 0; i < distinct.size(); ++i) {
+        if (i > 0 && (versions ? QApt::Package::compareVersion(distinct.at(i - 1), distinct.at(i)) < 0
+                               : distinct.at(i - 1) < distinct.at(i))) {
+            ++rank;
+        }
+        ranks[distinct.at(i)] = rank;
+    }
+
+    QVector<quint64> keys;
+    keys.reserve(values.size());
+    for (const QString &value : values) {
+        keys.append(ranks.value(value));
+    }
+
+    return keys;
 }
 
 PackageProxyModel::PackageProxyModel(QObject *parent)
@@ -62,6 +111,38 @@ PackageProxyModel::PackageProxyModel(QObject *parent)
     , m_sortByRelevancy(false)
     , m_useSearchResults(false)
 {
+    connect(FileIndex::self(), SIGNAL(searchFinished(QString,QStringList)),
+            this, SLOT(installedSearchFinished(QString,QStringList)));
+    connect(ContentsIndex::self(), SIGNAL(searchFinished(QString,QStringList)),
+            this, SLOT(contentsSearchFinished(QString,QStringList)));
+}
+
+void PackageProxyModel::setSourceModel(QAbstractItemModel *model)
+{
+    if (sourceModel()) {
+        disconnect(sourceModel(), nullptr, this, SLOT(invalidateSortRanks()));
+        disconnect(sourceModel(), nullptr, this, SLOT(invalidateChangedSortKeys(QModelIndex,QModelIndex)));
+        disconnect(sourceModel(), nullptr, this, SLOT(invalidateNameIndex()));
+    }
+    invalidateNameIndex();
+
+    // Connected before the base class does, so that ranks are dropped before
+    // a dynamic re-sort asks for them
+    if (model) {
+        connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QList<int>)),
+                this, SLOT(invalidateChangedSortKeys(QModelIndex,QModelIndex)));
+        connect(model, SIGNAL(modelReset()), this, SLOT(invalidateSortRanks()));
+        connect(model, SIGNAL(layoutChanged()), this, SLOT(invalidateSortRanks()));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(invalidateSortRanks()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(invalidateSortRanks()));
+        // Names do not change with the state of a package, so dataChanged() is left out
+        connect(model, SIGNAL(modelReset()), this, SLOT(invalidateNameIndex()));
+        connect(model, SIGNAL(layoutChanged()), this, SLOT(invalidateNameIndex()));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(invalidateNameIndex()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(invalidateNameIndex()));
+    }
+
+    QSortFilterProxyModel::setSourceModel(model);
 }
 
 void PackageProxyModel::setBackend(QApt::Backend *backend)
@@ -72,9 +153,28 @@ void PackageProxyModel::setBackend(QApt::Backend *backend)
 
 void PackageProxyModel::search(const QString &searchText)
 {
+    // "file:" searches for the packages owning a file instead
+    const bool fileSearch = searchText.startsWith(QLatin1String("file:"));
+    const QString query = fileSearch ? searchText.mid(5).trimmed() : searchText;
+
+    m_fileQuery.clear();
+
     // 1-character searches are painfully slow. >= 2 chars are fine, though
-    if (searchText.size() > 1) {
-        m_searchPackages = m_backend->search(searchText);
+    if (query.size() > 1) {
+        if (fileSearch) {
+            // Installed owners first, then whatever in the archive provides the path
+            m_searchPackages = fileOwners(FileIndex::self()->packagesOwning(query)
+                                          + ContentsIndex::self()->packagesProviding(query));
+            // Going through every path takes a while, so substring matches
+            // get added once they are found
+            if (!query.startsWith(QLatin1Char('/'))) {
+                m_fileQuery = query;
+                FileIndex::self()->search(query);
+                ContentsIndex::self()->search(query);
+            }
+        } else {
+            m_searchPackages = m_backend->search(query);
+        }
         if (!m_useSearchResults) {
             m_sortByRelevancy = true;
         }
@@ -86,12 +186,67 @@ void PackageProxyModel::search(const QString &searchText)
         m_useSearchResults = false;
     }
 
+    invalidateRelevancyKeys();
     invalidate();
 }
 
+QApt::PackageList PackageProxyModel::fileOwners(const QStringList &names) const
+{
+    QApt::PackageList packages;
+    for (const QString &name : names) {
+        // Lists of multi-arch packages carry the architecture in their name
+        QApt::Package *package = m_backend->package(name);
+        if (!package && name.contains(QLatin1Char(':'))) {
+            package = m_backend->package(name.section(QLatin1Char(':'), 0, 0));
+        }
+        if (package && !packages.contains(package)) {
+            packages.append(package);
+        }
+    }
+
+    return packages;
+}
+
+void PackageProxyModel::installedSearchFinished(const QString &query, const QStringList &names)
+{
+    // Installed owners go first, whether or not the archive was faster
+    addFileOwners(query, names, 0);
+}
+
+void PackageProxyModel::contentsSearchFinished(const QString &query, const QStringList &names)
+{
+    addFileOwners(query, names, -1);
+}
+
+void PackageProxyModel::addFileOwners(const QString &query, const QStringList &names, int position)
+{
+    if (query != m_fileQuery || !m_backend) {
+        return;
+    }
+
+    int added = 0;
+    const QApt::PackageList packages = fileOwners(names);
+    for (QApt::Package *package : packages) {
+        if (!m_searchPackages.contains(package)) {
+            if (position < 0) {
+                m_searchPackages.append(package);
+            } else {
+                m_searchPackages.insert(position + added, package);
+            }
+            ++added;
+        }
+    }
+
+    if (added) {
+        invalidateRelevancyKeys();
+        invalidate();
+    }
+}
+
 void PackageProxyModel::setSortByRelevancy(bool enabled)
 {
     m_sortByRelevancy = enabled;
+    m_sortRanks.clear();
     invalidate();
 }
 
@@ -184,40 +339,287 @@ void PackageProxyModel::reset()
     invalidate();
 }
 
-bool PackageProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+void PackageProxyModel::sort(int column, Qt::SortOrder order)
+{
+    // Reversing the primary key keeps the secondary ones, picking another
+    // column starts over
+    if (m_sortKeys.isEmpty() || m_sortKeys.constFirst().column != column) {
+        m_sortKeys.clear();
+        if (column >= 0) {
+            m_sortKeys.append({column, order});
+        }
+    } else {
+        m_sortKeys.first().order = order;
+    }
+
+    // Only the order changed, the keys of every column still hold
+    m_sortRanks.clear();
+    Q_EMIT headerDataChanged(Qt::Horizontal, 0, columnCount() - 1);
+    QSortFilterProxyModel::sort(column, order);
+}
+
+void PackageProxyModel::addSortKey(int column)
+{
+    if (m_sortKeys.isEmpty()) {
+        return;
+    }
+
+    auto it = std::find_if(m_sortKeys.begin() + 1, m_sortKeys.end(), [column](const SortKey &key) {
+        return key.column == column;
+    });
+    if (it != m_sortKeys.end()) {
+        it->order = it->order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+    } else if (column != m_sortKeys.constFirst().column) {
+        m_sortKeys.append({column, Qt::AscendingOrder});
+    }
+
+    m_sortRanks.clear();
+    Q_EMIT headerDataChanged(Qt::Horizontal, 0, columnCount() - 1);
+    invalidate();
+}
+
+QVariant PackageProxyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    const QVariant title = QSortFilterProxyModel::headerData(section, orientation, role);
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return title;
+    }
+
+    // Secondary keys carry their priority, the primary one has the sort indicator
+    for (int i = 1; i < m_sortKeys.size(); ++i) {
+        if (m_sortKeys.at(i).column == section) {
+            return i18nc("@title:column %1 is the column title, %2 its sort priority",
+                         "%1 (%2)", title.toString(), i + 1);
+        }
+    }
+
+    return title;
+}
+
+void PackageProxyModel::invalidateSortRanks()
+{
+    m_sortRanks.clear();
+    m_columnKeys.clear();
+}
+
+void PackageProxyModel::invalidateChangedSortKeys(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // Marking packages changes their state, and a new candidate version its
+    // sizes and the like. Names and installed versions stay what they are,
+    // and those are the keys that take long to build
+    bool dropped = false;
+    for (int column = topLeft.column(); column <= bottomRight.column(); ++column) {
+        if (column == PackageModel::NameColumn || column == PackageModel::InstalledVersionColumn) {
+            continue;
+        }
+        dropped |= m_columnKeys.remove(column) > 0;
+    }
+
+    if (dropped) {
+        m_sortRanks.clear();
+    }
+}
+
+void PackageProxyModel::invalidateRelevancyKeys()
+{
+    if (m_columnKeys.remove(relevancyKeys) > 0 || m_sortByRelevancy) {
+        m_sortRanks.clear();
+    }
+}
+
+void PackageProxyModel::invalidateNameIndex()
+{
+    m_nameIndex.clear();
+}
+
+QModelIndex PackageProxyModel::indexStartingWith(const QString &prefix, int fromRow) const
+{
+    const int rows = sourceModel() ? sourceModel()->rowCount() : 0;
+    if (m_nameIndex.size() != rows) {
+        m_nameIndex.clear();
+        m_nameIndex.reserve(rows);
+        for (int row = 0; row < rows; ++row) {
+            m_nameIndex.append({ sourceModel()->index(row, 0).data(PackageModel::NameRole).toString().toLower(), row });
+        }
+        std::sort(m_nameIndex.begin(), m_nameIndex.end());
+    }
+
+    // All names with the prefix are next to each other in the index, and
+    // mapping them to the view tells which come first in whatever order the
+    // view is sorted by
+    const QString key = prefix.toLower();
+    auto it = std::lower_bound(m_nameIndex.cbegin(), m_nameIndex.cend(), key,
+                               [](const QPair<QString, int> &entry, const QString &name) {
+        return entry.first < name;
+    });
+
+    int nextRow = -1;
+    int firstRow = -1;
+    for (; it != m_nameIndex.cend() && it->first.startsWith(key); ++it) {
+        const QModelIndex proxyIndex = mapFromSource(sourceModel()->index(it->second, 0));
+        if (!proxyIndex.isValid()) {
+            // Filtered out
+            continue;
+        }
+
+        const int row = proxyIndex.row();
+        if (row >= fromRow && (nextRow < 0 || row < nextRow)) {
+            nextRow = row;
+        }
+        if (firstRow < 0 || row < firstRow) {
+            firstRow = row;
+        }
+    }
+
+    const int row = nextRow >= 0 ? nextRow : firstRow;
+    return row >= 0 ? index(row, 0) : QModelIndex();
+}
+
+QVector<quint64> PackageProxyModel::sortKeys(int column) const
+{
+    // Relevancy takes the place of the name, but is not the same key
+    const int cacheKey = column == 0 && m_sortByRelevancy ? relevancyKeys : column;
+    auto cached = m_columnKeys.constFind(cacheKey);
+    if (cached != m_columnKeys.constEnd()) {
+        return cached.value();
+    }
+
+    const QVector<quint64> keys = computeSortKeys(column);
+    m_columnKeys.insert(cacheKey, keys);
+    return keys;
+}
+
+QVector<quint64> PackageProxyModel::computeSortKeys(int column) const
 {
     PackageModel *model = static_cast<PackageModel *>(sourceModel());
-    QApt::Package *leftPackage = model->packageAt(left);
-    QApt::Package *rightPackage = model->packageAt(right);
-
-    switch (left.column()) {
-      case 0:
-          if (m_sortByRelevancy) {
-              // This is expensive for very large datasets. It takes about 3 seconds with 30,000 packages
-              // The order in m_packages is based on relevancy when returned by m_backend->search()
-              // Use this order to determine less than
-              return (m_searchPackages.indexOf(leftPackage) > m_searchPackages.indexOf(rightPackage));
-          } else {
-              QString leftString = left.data(PackageModel::NameRole).toString();
-              QString rightString = right.data(PackageModel::NameRole).toString();
-
-              return leftString < rightString;
-          }
-      case 1:
-          return packageStatusLessThan(leftPackage, rightPackage);
-      case 2:
-          return packageRequestedLessThan(leftPackage, rightPackage);
-      case 3: /* Installed size */
-          {
-              qlonglong leftSize = left.data(PackageModel::InstalledSizeRole).toLongLong();
-              qlonglong rightSize = right.data(PackageModel::InstalledSizeRole).toLongLong();
-              return leftSize < rightSize;
-          }
-      case 4: /* Installed version */
-          return QApt::Package::compareVersion(leftPackage->installedVersion(), rightPackage->installedVersion()) < 0;
-      case 5: /* Available version */
-          return QApt::Package::compareVersion(leftPackage->availableVersion(), rightPackage->availableVersion()) < 0;
-    }
-
-    return false;
+    const QApt::PackageList packages = model->packages();
+    const int rows = packages.size();
+
+    QVector<quint64> keys;
+    keys.reserve(rows);
+
+    switch (column) {
+    case 0:
+        if (m_sortByRelevancy) {
+            // The order of m_searchPackages is the relevancy. Later results
+            // sort first, and anything not found sorts last
+            QHash<QApt::Package *, int> positions;
+            positions.reserve(m_searchPackages.size());
+            for (int i = 0; i < m_searchPackages.size(); ++i) {
+                positions.insert(m_searchPackages.at(i), i);
+            }
+            for (QApt::Package *package : packages) {
+                keys.append(quint64(m_searchPackages.size() - positions.value(package, -1)));
+            }
+        } else {
+            QVector<QString> names;
+            names.reserve(rows);
+            for (int row = 0; row < rows; ++row) {
+                names.append(model->index(row, 0).data(PackageModel::NameRole).toString());
+            }
+            keys = stringSortKeys(names, false);
+        }
+        break;
+    case 1:
+        for (QApt::Package *package : packages) {
+            keys.append(package->state() & status_sort_magic);
+        }
+        break;
+    case 2:
+        for (QApt::Package *package : packages) {
+            keys.append(package->state() & requested_sort_magic);
+        }
+        break;
+    case 3: /* Installed size */
+        for (QApt::Package *package : packages) {
+            keys.append(signedSortKey(package->installedSize()));
+        }
+        break;
+    case 4: /* Installed version */
+    case 5: /* Available version */
+        {
+            QVector<QString> versions;
+            versions.reserve(rows);
+            for (QApt::Package *package : packages) {
+                versions.append(column == 4 ? package->installedVersion() : package->availableVersion());
+            }
+            keys = stringSortKeys(versions, true);
+        }
+        break;
+    case PackageModel::DownloadSizeColumn:
+        for (int row = 0; row < rows; ++row) {
+            keys.append(signedSortKey(model->index(row, column).data(PackageModel::ColumnValueRole).toLongLong()));
+        }
+        break;
+    case PackageModel::SupportEndColumn:
+        for (int row = 0; row < rows; ++row) {
+            keys.append(signedSortKey(model->index(row, column).data(PackageModel::ColumnValueRole).toDate().toJulianDay()));
+        }
+        break;
+    default: /* Optional text columns */
+        {
+            QVector<QString> values;
+            values.reserve(rows);
+            for (int row = 0; row < rows; ++row) {
+                values.append(model->index(row, column).data(PackageModel::ColumnValueRole).toString());
+            }
+            keys = stringSortKeys(values, false);
+        }
+        break;
+    }
+
+    return keys;
+}
+
+void PackageProxyModel::buildSortRanks() const
+{
+    const int rows = sourceModel()->rowCount();
+
+    // One packed key per sort column, with descending keys inverted, and the
+    // name last so that ties always come out the same way
+    QVector<QVector<quint64>> keys;
+    bool sortedByName = false;
+    for (const SortKey &sortKey : m_sortKeys) {
+        QVector<quint64> columnKeys = sortKeys(sortKey.column);
+        if (sortKey.order == Qt::DescendingOrder) {
+            for (quint64 &key : columnKeys) {
+                key = ~key;
+            }
+        }
+        keys.append(columnKeys);
+        sortedByName |= sortKey.column == 0 && !m_sortByRelevancy;
+    }
+    if (!sortedByName) {
+        keys.append(sortKeys(0));
+    }
+
+    QVector<int> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](int left, int right) {
+        for (const QVector<quint64> &columnKeys : keys) {
+            if (columnKeys.at(left) != columnKeys.at(right)) {
+                return columnKeys.at(left) < columnKeys.at(right);
+            }
+        }
+        return false;
+    });
+
+    m_sortRanks.resize(rows);
+    for (int i = 0; i < rows; ++i) {
+        m_sortRanks[order.at(i)] = i;
+    }
+}
+
+bool PackageProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    // Every comparison of a sort is a lookup into ranks computed up front
+    if (m_sortRanks.size() != sourceModel()->rowCount()) {
+        buildSortRanks();
+    }
+
+    // Ranks already honour the order of every key, so undo the reversal
+    // QSortFilterProxyModel applies for a descending sort
+    const int leftRank = m_sortRanks.at(left.row());
+    const int rightRank = m_sortRanks.at(right.row());
+    return sortOrder() == Qt::AscendingOrder ? leftRank < rightRank : leftRank > rightRank;
 }
@@ -22,7 +22,9 @@
 #define PACKAGEPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QtCore/QHash>
 #include <QtCore/QString>
+#include <QtCore/QVector>
 
 #include <QApt/Package>
 
@@ -36,6 +38,7 @@ class PackageProxyModel : public QSortFilterProxyModel
 public:
     PackageProxyModel(QObject *parent);
 
+    void setSourceModel(QAbstractItemModel *model) override;
     void setBackend(QApt::Backend *backend);
     void search(const QString &searchText);
     void setSortByRelevancy(bool enabled);
@@ -49,15 +52,43 @@ public:
     QApt::Package *packageAt(const QModelIndex &index) const;
     void reset();
 
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    /**
+     * Sorts by @p column after the current sort column and any keys added
+     * before, or reverses it if it is a secondary key already
+     */
+    void addSortKey(int column);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @returns the first package shown at or below @p fromRow whose name starts
+     * with @p prefix, ignoring case, or the first one above if there is none
+     */
+    QModelIndex indexStartingWith(const QString &prefix, int fromRow = 0) const;
+
 protected:
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
 
+private Q_SLOTS:
+    void invalidateSortRanks();
+    void invalidateChangedSortKeys(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void invalidateNameIndex();
+    void installedSearchFinished(const QString &query, const QStringList &names);
+    void contentsSearchFinished(const QString &query, const QStringList &names);
+
 private:
+    struct SortKey {
+        int column;
+        Qt::SortOrder order;
+    };
+
     QApt::Backend *m_backend;
     QApt::PackageList m_packages;
     QApt::PackageList m_searchPackages;
 
     QString m_searchText;
+    // File search whose substring matches are still to come
+    QString m_fileQuery;
     QString m_groupFilter;
     QApt::Package::State m_stateFilter;
     QString m_originFilter;
@@ -65,6 +96,25 @@ private:
 
     bool m_sortByRelevancy;
     bool m_useSearchResults;
+
+    // The primary key is the one QSortFilterProxyModel sorts by
+    QVector<SortKey> m_sortKeys;
+    // Position of every source row in the composite order, empty when stale
+    mutable QVector<int> m_sortRanks;
+    // Keys of every source row by column, built when a sort first needs them
+    mutable QHash<int, QVector<quint64>> m_columnKeys;
+
+    // Lowercased names with their source rows, sorted by name, empty when stale
+    mutable QVector<QPair<QString, int>> m_nameIndex;
+
+    QVector<quint64> sortKeys(int column) const;
+    QVector<quint64> computeSortKeys(int column) const;
+    void invalidateRelevancyKeys();
+    void buildSortRanks() const;
+
+    QApt::PackageList fileOwners(const QStringList &names) const;
+    /** Adds the owners @p names found for @p query at @p position, or at the end if that is negative */
+    void addFileOwners(const QString &query, const QStringList &names, int position);
 };
 
 #endif
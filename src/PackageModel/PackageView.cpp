@@ -20,11 +20,34 @@
 
 #include "PackageView.h"
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEvent>
+#include <QtCore/QTimer>
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QHeaderView>
+
+#include <QApt/Package>
+
+#include "PackageModel.h"
+#include "PackageProxyModel.h"
 #include "PackageViewHeader.h"
 
+// Rows measured for a first estimate, on top of the visible ones
+constexpr int sampledRowCount = 128;
+// Time the catch-up pass may spend per slice, in msecs
+constexpr int measureSliceTime = 4;
+
 PackageView::PackageView(QWidget *parent)
     : QTreeView(parent)
+    , m_measuredRows(0)
+    , m_measureTimer(new QTimer(this))
+    , m_sampleFirst(0)
+    , m_sampleLast(-1)
+    , m_sampleStride(1)
 {
+    m_measureTimer->setInterval(0);
+    connect(m_measureTimer, &QTimer::timeout, this, &PackageView::measureMoreRows);
+
     setHeader(new PackageViewHeader());
     setAlternatingRowColors(true);
     setContextMenuPolicy(Qt::CustomContextMenu);
@@ -35,25 +58,91 @@ PackageView::PackageView(QWidget *parent)
     header()->setDefaultAlignment(Qt::AlignLeft);
 }
 
+void PackageView::setModel(QAbstractItemModel *model)
+{
+    if (QAbstractItemModel *oldModel = this->model()) {
+        disconnect(oldModel, nullptr, this, SLOT(invalidateColumnWidths()));
+        disconnect(oldModel, nullptr, this, SLOT(invalidateChangedColumns(QModelIndex,QModelIndex)));
+        disconnect(oldModel, nullptr, this, SLOT(invalidateRowColumns()));
+        disconnect(oldModel, nullptr, this, SLOT(recountSelection()));
+    }
+
+    QTreeView::setModel(model);
+    invalidateColumnWidths();
+    recountSelection();
+
+    if (model) {
+        connect(model, SIGNAL(modelReset()), this, SLOT(invalidateColumnWidths()));
+        connect(model, SIGNAL(layoutChanged()), this, SLOT(invalidateColumnWidths()));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(invalidateRowColumns()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(invalidateRowColumns()));
+        connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QList<int>)),
+                this, SLOT(invalidateChangedColumns(QModelIndex,QModelIndex)));
+        // The selection model follows these without reporting what it
+        // dropped, so they are the only times the selection gets walked. A
+        // re-sort or refilter only moves rows around, the totals stay put
+        connect(model, SIGNAL(modelReset()), this, SLOT(recountSelection()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(recountSelection()));
+    }
+}
+
+void PackageView::keyboardSearch(const QString &search)
+{
+    auto *proxy = qobject_cast<PackageProxyModel *>(model());
+    if (!proxy || search.isEmpty()) {
+        QTreeView::keyboardSearch(search);
+        return;
+    }
+
+    // Keys typed in quick succession make up one prefix
+    if (!m_keyboardInputTime.isValid() || m_keyboardInputTime.elapsed() > QApplication::keyboardInputInterval()) {
+        m_keyboardSearch.clear();
+    }
+    m_keyboardSearch += search;
+    m_keyboardInputTime.start();
+
+    // Typing the same letter again moves on to the next package with that
+    // letter, a longer prefix may still match the current package
+    const bool sameLetter = m_keyboardSearch.count(m_keyboardSearch.at(0)) == m_keyboardSearch.size();
+    const QString prefix = sameLetter ? m_keyboardSearch.left(1) : m_keyboardSearch;
+    const int currentRow = currentIndex().isValid() ? currentIndex().row() : -1;
+
+    const QModelIndex index = proxy->indexStartingWith(prefix, sameLetter ? currentRow + 1 : qMax(currentRow, 0));
+    if (index.isValid()) {
+        setCurrentIndex(index);
+        scrollTo(index);
+    }
+}
+
 int PackageView::selectionCount() const
 {
-    return selectionModel()->selectedRows().count();
+    return m_selectionSummary.count;
+}
+
+const SelectionSummary &PackageView::selectionSummary() const
+{
+    return m_selectionSummary;
 }
 
 void PackageView::selectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
 {
     QTreeView::selectionChanged(selected, deselected);
 
+    addToSelectionSummary(deselected, -1);
+    addToSelectionSummary(selected, 1);
+    Q_EMIT selectionSummaryChanged();
+
     const int count = selectionCount();
     if (count <= 0) {
         Q_EMIT selectionEmpty();
         return;
     }
 
+    // Look at the ranges only, listing the indexes of a big selection is not cheap
     if (selected.isEmpty()) {
-        Q_EMIT currentPackageChanged(selectedIndexes().last());
+        Q_EMIT currentPackageChanged(selectionModel()->selection().constLast().bottomRight());
     } else {
-        Q_EMIT currentPackageChanged(selected.indexes().first());
+        Q_EMIT currentPackageChanged(selected.constFirst().topLeft());
     }
     if(count > 1) {
         Q_EMIT selectionMulti();
@@ -64,5 +153,214 @@ void PackageView::updateView()
 {
     QModelIndex oldIndex = currentIndex();
     reset();
+    // The selection got cleared without a word
+    recountSelection();
     setCurrentIndex(oldIndex);
 }
+
+int PackageView::sizeHintForColumn(int column) const
+{
+    if (column < 0 || !model()) {
+        return -1;
+    }
+
+    while (m_columnWidths.size() <= column) {
+        m_columnWidths.append(-1);
+    }
+    if (m_columnWidths.at(column) >= 0) {
+        return m_columnWidths.at(column);
+    }
+
+    const int rows = model()->rowCount(rootIndex());
+    if (!rows) {
+        return -1;
+    }
+
+    // What the user is looking at has to fit, the sample stands in for the rest
+    int first = indexAt(viewport()->rect().topLeft()).row();
+    int last = indexAt(viewport()->rect().bottomLeft()).row();
+    first = qMax(first, 0);
+    last = last < 0 ? qMin(rows - 1, first + sampledRowCount) : last;
+
+    m_sampleFirst = first;
+    m_sampleLast = last;
+    m_sampleStride = qMax(1, rows / sampledRowCount);
+
+    int width = measureRows(column, first, last);
+    width = qMax(width, measureRows(column, 0, rows - 1, m_sampleStride));
+    m_columnWidths[column] = width;
+
+    if (m_measuredRows < rows) {
+        m_measureTimer->start();
+    }
+
+    return width;
+}
+
+void PackageView::changeEvent(QEvent *event)
+{
+    QTreeView::changeEvent(event);
+
+    if (event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange) {
+        invalidateColumnWidths();
+    }
+}
+
+void PackageView::invalidateColumnWidths()
+{
+    m_columnWidths.fill(-1);
+    m_measuredRows = 0;
+    m_measureTimer->stop();
+}
+
+void PackageView::invalidateChangedColumns(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // Marking a package reports every row as changed, so this must not start
+    // the estimate over. Only the changed rows that the estimate was taken
+    // from are measured again, which can widen a column but not narrow it.
+    // The catch-up pass picks up the other rows as it goes
+    const int rows = model() ? model()->rowCount(rootIndex()) : 0;
+    const int top = qMax(topLeft.row(), 0);
+    const int bottom = qMin(bottomRight.row(), rows - 1);
+    if (bottom < top) {
+        return;
+    }
+
+    const int visibleFirst = qMax(top, m_sampleFirst);
+    const int visibleLast = qMin(bottom, m_sampleLast);
+    const int sampledFirst = (top + m_sampleStride - 1) / m_sampleStride * m_sampleStride;
+    if (visibleFirst > visibleLast && sampledFirst > bottom) {
+        return;
+    }
+
+    const int last = qMin(bottomRight.column(), int(m_columnWidths.size()) - 1);
+    for (int column = qMax(topLeft.column(), 0); column <= last; ++column) {
+        if (m_columnWidths.at(column) < 0 || isColumnHidden(column)) {
+            continue;
+        }
+
+        int width = m_columnWidths.at(column);
+        if (visibleFirst <= visibleLast) {
+            width = qMax(width, measureRows(column, visibleFirst, visibleLast));
+        }
+        if (sampledFirst <= bottom) {
+            width = qMax(width, measureRows(column, sampledFirst, bottom, m_sampleStride));
+        }
+
+        if (width > m_columnWidths.at(column)) {
+            m_columnWidths[column] = width;
+            if (header()->sectionResizeMode(column) == QHeaderView::ResizeToContents) {
+                resizeColumnToContents(column);
+            }
+        }
+    }
+}
+
+void PackageView::invalidateRowColumns()
+{
+    const QVector<int> measured = m_columnWidths;
+    invalidateColumnWidths();
+
+    for (int column = 0; column < measured.size(); ++column) {
+        if (measured.at(column) >= 0 && header()->sectionResizeMode(column) == QHeaderView::ResizeToContents) {
+            resizeColumnToContents(column);
+        }
+    }
+}
+
+void PackageView::measureMoreRows()
+{
+    const int rows = model() ? model()->rowCount(rootIndex()) : 0;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QVector<int> widened;
+    while (m_measuredRows < rows && elapsed.elapsed() < measureSliceTime) {
+        const int last = qMin(rows, m_measuredRows + 64) - 1;
+        for (int column = 0; column < m_columnWidths.size(); ++column) {
+            if (m_columnWidths.at(column) < 0 || isColumnHidden(column)) {
+                continue;
+            }
+            const int width = measureRows(column, m_measuredRows, last);
+            if (width > m_columnWidths.at(column)) {
+                m_columnWidths[column] = width;
+                if (!widened.contains(column)) {
+                    widened.append(column);
+                }
+            }
+        }
+        m_measuredRows = last + 1;
+    }
+
+    if (m_measuredRows >= rows) {
+        m_measureTimer->stop();
+    }
+
+    // Columns sized once by the user stay as they are, only the
+    // self-sizing ones follow the better estimate
+    for (int column : std::as_const(widened)) {
+        if (header()->sectionResizeMode(column) == QHeaderView::ResizeToContents) {
+            resizeColumnToContents(column);
+        }
+    }
+}
+
+int PackageView::measureRows(int column, int first, int last, int step) const
+{
+    QStyleOptionViewItem option;
+    initViewItemOption(&option);
+
+    int width = 0;
+    for (int row = first; row <= last; row += step) {
+        const QModelIndex index = model()->index(row, column, rootIndex());
+        width = qMax(width, itemDelegateForIndex(index)->sizeHint(option, index).width());
+    }
+
+    return width;
+}
+
+void PackageView::addToSelectionSummary(const QItemSelection &selection, int sign)
+{
+    auto *proxy = qobject_cast<PackageProxyModel *>(model());
+    if (!proxy) {
+        return;
+    }
+
+    for (const QItemSelectionRange &range : selection) {
+        // Every selected row has exactly one range starting at the first column
+        if (range.left() != 0) {
+            continue;
+        }
+
+        for (int row = range.top(); row <= range.bottom(); ++row) {
+            // Straight from the package, the model only keeps values of shown columns
+            QApt::Package *package = proxy->packageAt(proxy->index(row, 0, range.parent()));
+            if (!package) {
+                continue;
+            }
+            const int state = package->state();
+            const qint64 installedSize = package->installedSize();
+            const qint64 downloadSize = package->downloadSize();
+
+            m_selectionSummary.count += sign;
+            if (state & QApt::Package::Installed) {
+                m_selectionSummary.installed += sign;
+            }
+            if (state & QApt::Package::Upgradeable) {
+                m_selectionSummary.upgradeable += sign;
+            }
+            m_selectionSummary.installedSize += sign * qMax<qint64>(installedSize, 0);
+            m_selectionSummary.downloadSize += sign * qMax<qint64>(downloadSize, 0);
+        }
+    }
+}
+
+void PackageView::recountSelection()
+{
+    m_selectionSummary = SelectionSummary();
+    if (selectionModel()) {
+        addToSelectionSummary(selectionModel()->selection(), 1);
+    }
+    Q_EMIT selectionSummaryChanged();
+}
@@ -21,8 +21,24 @@
 #ifndef PACKAGEVIEW_H
 #define PACKAGEVIEW_H
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
 #include <QtWidgets/QTreeView>
 
+class QTimer;
+
+/**
+ * Running totals over the selected packages
+ */
+struct SelectionSummary
+{
+    int count = 0;
+    int installed = 0;
+    int upgradeable = 0;
+    qint64 installedSize = 0;
+    qint64 downloadSize = 0;
+};
+
 class PackageView : public QTreeView
 {
     Q_OBJECT
@@ -30,6 +46,20 @@ public:
     explicit PackageView(QWidget *parent = nullptr);
 
     int selectionCount() const;
+    const SelectionSummary &selectionSummary() const;
+
+    void setModel(QAbstractItemModel *model) override;
+    /** Jumps to the next package whose name starts with what was typed */
+    void keyboardSearch(const QString &search) override;
+
+protected:
+    /**
+     * Estimates the width of @p column in constant time, from the visible rows
+     * and an evenly spread sample. The remaining rows are measured in small
+     * slices afterwards, widening the estimate if needed.
+     */
+    int sizeHintForColumn(int column) const override;
+    void changeEvent(QEvent *event) override;
 
 protected Q_SLOTS:
     void selectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
@@ -37,10 +67,41 @@ protected Q_SLOTS:
 public Q_SLOTS:
     void updateView();
 
+private Q_SLOTS:
+    void invalidateColumnWidths();
+    void invalidateChangedColumns(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void invalidateRowColumns();
+    void measureMoreRows();
+    void recountSelection();
+
+private:
+    // Estimated content width per column, -1 for columns nobody asked about yet
+    mutable QVector<int> m_columnWidths;
+    // Rows below this one are yet to be measured by the catch-up pass
+    mutable int m_measuredRows;
+    QTimer *m_measureTimer;
+    // Rows the last estimate was taken from: the visible ones, and every
+    // one a multiple of the stride away from the first row
+    mutable int m_sampleFirst;
+    mutable int m_sampleLast;
+    mutable int m_sampleStride;
+
+    // What was typed for keyboardSearch() so far, and when
+    QString m_keyboardSearch;
+    QElapsedTimer m_keyboardInputTime;
+
+    // Kept up to date from selection deltas, so that big selections cost
+    // nothing once made
+    SelectionSummary m_selectionSummary;
+
+    int measureRows(int column, int first, int last, int step = 1) const;
+    void addToSelectionSummary(const QItemSelection &selection, int sign);
+
 Q_SIGNALS:
     void currentPackageChanged(const QModelIndex &current);
     void selectionEmpty();
     void selectionMulti();
+    void selectionSummaryChanged();
 };
 
 #endif
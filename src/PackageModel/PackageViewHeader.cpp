@@ -23,6 +23,7 @@
 #include <QAction>
 #include <QMenu>
 #include <QContextMenuEvent>
+#include <QMouseEvent>
 
 #include "PackageProxyModel.h"
 
@@ -61,6 +62,30 @@ void PackageViewHeader::contextMenuEvent(QContextMenuEvent *event)
     deleteActions();
 }
 
+void PackageViewHeader::mouseReleaseEvent(QMouseEvent *event)
+{
+    const int primarySection = sortIndicatorSection();
+    const Qt::SortOrder primaryOrder = sortIndicatorOrder();
+    const int section = logicalIndexAt(event->position().toPoint());
+
+    if (!(event->modifiers() & Qt::ShiftModifier) || section < 0 || section == primarySection || !model()) {
+        QHeaderView::mouseReleaseEvent(event);
+        return;
+    }
+
+    // Shift-click adds a secondary sort key rather than sorting by the
+    // clicked column only, so keep the view from hearing about the flip
+    blockSignals(true);
+    QHeaderView::mouseReleaseEvent(event);
+    const bool clicked = sortIndicatorSection() != primarySection;
+    setSortIndicator(primarySection, primaryOrder);
+    blockSignals(false);
+
+    if (clicked) {
+        static_cast<PackageProxyModel*>(model())->addSortKey(section);
+    }
+}
+
 void PackageViewHeader::createActions()
 {
     QAbstractItemModel *m = model();
@@ -104,5 +129,6 @@ void PackageViewHeader::toggleColumn(bool visible)
     if (action) {
         int column = action->data().toInt();
         setSectionHidden(column, !visible);
+        Q_EMIT columnVisibilityChanged(column, visible);
     }
 }
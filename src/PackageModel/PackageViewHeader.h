@@ -32,8 +32,12 @@ public:
 
     void setModel(QAbstractItemModel *model) override;
 
+Q_SIGNALS:
+    void columnVisibilityChanged(int column, bool visible);
+
 protected:
     void contextMenuEvent(QContextMenuEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event) override;
 
 private Q_SLOTS:
     void modelLayoutChanged();
@@ -24,6 +24,8 @@
 // Qt includes
 #include <QtConcurrentRun>
 #include <QApplication>
+#include <QFileDialog>
+#include <QProgressDialog>
 #include <QtCore/QTimer>
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QPushButton>
@@ -35,6 +37,7 @@
 
 // KDE includes
 #include <KComboBox>
+#include <KFormat>
 #include <KLocalizedString>
 #include <KMessageBox>
 
@@ -44,13 +47,19 @@
 #include <QApt/MarkingErrorInfo>
 
 // Own includes
+#include "muonapt/AppStreamIcons.h"
 #include "muonapt/ChangesDialog.h"
+#include "muonapt/ContentsIndex.h"
+#include "muonapt/DependencyGraph.h"
+#include "muonapt/FileIndex.h"
 #include "DetailsWidget.h"
 #include "MuonSettings.h"
 #include "PackageModel.h"
 #include "PackageProxyModel.h"
 #include "PackageView.h"
+#include "PackageViewHeader.h"
 #include "PackageDelegate.h"
+#include "PackageExporter.h"
 #include "Widgets/BusyIndicator.h"
 
 bool packageNameLessThan(QApt::Package *p1, QApt::Package *p2)
@@ -76,9 +85,11 @@ PackageWidget::PackageWidget(QWidget *parent)
     connect(m_watcher, SIGNAL(finished()), this, SLOT(setSortedPackages()));
 
     m_model = new PackageModel(this);
-    PackageDelegate *delegate = new PackageDelegate(this);
+    m_delegate = new PackageDelegate(this);
     m_proxyModel = new PackageProxyModel(this);
     m_proxyModel->setSourceModel(m_model);
+    m_exporter = new PackageExporter(this);
+    connect(m_exporter, &PackageExporter::finished, this, &PackageWidget::exportFinished);
 
     QVBoxLayout *topVBox = new QVBoxLayout;
     topVBox->setContentsMargins(QMargins());
@@ -99,20 +110,34 @@ PackageWidget::PackageWidget(QWidget *parent)
     m_searchEdit->setEnabled(false);
     m_searchEdit->setPlaceholderText(i18nc("@label Line edit click message", "Search"));
     m_searchEdit->setClearButtonEnabled(true);
+    m_searchEdit->setToolTip(i18nc("@info:tooltip", "Start with \"file:\" to search for the packages containing a file"));
     m_searchEdit->hide(); // Off by default, use showSearchEdit() to show
     topVBox->addWidget(m_searchEdit);
 
     m_packageView = new PackageView;
     m_packageView->setModel(m_proxyModel);
-    m_packageView->setItemDelegate(delegate);
+    m_packageView->setItemDelegate(m_delegate);
+    // Repaints are coalesced, so a burst of decoded icons costs one of them
+    connect(AppStreamIcons::self(), &AppStreamIcons::iconReady,
+            m_packageView->viewport(), qOverload<>(&QWidget::update));
+    connect(AppStreamIcons::self(), &AppStreamIcons::loaded,
+            m_packageView->viewport(), qOverload<>(&QWidget::update));
     m_packageView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
     const int numColumns = m_packageView->header()->count();
     Q_ASSERT(numColumns >= 3);
     for (int i = 3; i < numColumns; ++i) {
         m_packageView->header()->setSectionHidden(i, true);
     }
+    connect(static_cast<PackageViewHeader *>(m_packageView->header()), &PackageViewHeader::columnVisibilityChanged,
+            this, &PackageWidget::columnVisibilityChanged);
     topVBox->addWidget(m_packageView);
 
+    m_selectionLabel = new QLabel;
+    m_selectionLabel->hide();
+    connect(m_packageView, &PackageView::selectionSummaryChanged,
+            this, &PackageWidget::updateSelectionSummary);
+    topVBox->addWidget(m_selectionLabel);
+
     m_detailsWidget = new DetailsWidget;
     connect(m_detailsWidget, SIGNAL(setInstall(QApt::Package*)),
             this, SLOT(setInstall(QApt::Package*)));
@@ -126,6 +151,8 @@ PackageWidget::PackageWidget(QWidget *parent)
             this, SLOT(setKeep(QApt::Package*)));
     connect(m_detailsWidget, SIGNAL(setPurge(QApt::Package*)),
             this, SLOT(setPurge(QApt::Package*)));
+    connect(m_detailsWidget, SIGNAL(packageRequested(QString)),
+            this, SLOT(showPackage(QString)));
 
     m_busyWidget = new BusyIndicator(m_packageView->viewport());
 
@@ -238,7 +265,24 @@ QByteArray PackageWidget::saveColumnsState() const
 
 bool PackageWidget::restoreColumnsState(const QByteArray& state)
 {
-    return m_packageView->header()->restoreState(state);
+    if (!m_packageView->header()->restoreState(state)) {
+        return false;
+    }
+
+    for (int i = PackageModel::DownloadSizeColumn; i < PackageModel::ColumnCount; ++i) {
+        if (m_packageView->header()->isSectionHidden(i)) {
+            m_model->releaseColumn(i);
+        }
+    }
+    return true;
+}
+
+void PackageWidget::columnVisibilityChanged(int column, bool visible)
+{
+    // Hidden columns are neither painted nor sorted, so their values can go
+    if (!visible) {
+        m_model->releaseColumn(column);
+    }
 }
 
 void PackageWidget::setBackend(QApt::Backend *backend)
@@ -249,6 +293,8 @@ void PackageWidget::setBackend(QApt::Backend *backend)
     connect(m_backend, SIGNAL(cacheReloadStarted()), this, SLOT(cacheReloadStarted()));
     connect(m_backend, SIGNAL(cacheReloadFinished()), this, SLOT(cacheReloadFinished()));
     connect(m_backend, SIGNAL(xapianUpdateFinished()), this, SLOT(startSearch()));
+    connect(FileIndex::self(), SIGNAL(updated()), this, SLOT(fileIndexUpdated()));
+    connect(ContentsIndex::self(), SIGNAL(updated()), this, SLOT(fileIndexUpdated()));
 
     m_detailsWidget->setBackend(backend);
     m_proxyModel->setBackend(m_backend);
@@ -269,6 +315,12 @@ void PackageWidget::reload()
 void PackageWidget::cacheReloadStarted()
 {
     m_detailsWidget->clear();
+    m_delegate->clearCache();
+    // The export reads the packages that are about to go away
+    if (m_exporter->isRunning()) {
+        m_exporter->cancelAndWait();
+        delete m_exportProgress;
+    }
     m_model->clear();
     m_proxyModel->invalidate();
     m_proxyModel->reset();
@@ -284,6 +336,89 @@ void PackageWidget::cacheReloadFinished()
     startSearch();
 }
 
+void PackageWidget::exportPackages()
+{
+    if (m_exporter->isRunning()) {
+        return;
+    }
+
+    const QString csvFilter = i18nc("@item:inlistbox file type", "CSV files (*.csv)");
+    const QString jsonFilter = i18nc("@item:inlistbox file type", "JSON files (*.json)");
+    QString selectedFilter;
+    const QString fileName = QFileDialog::getSaveFileName(this, i18nc("@title:window", "Export Package List"),
+                                                          QString(), csvFilter + QLatin1String(";;") + jsonFilter,
+                                                          &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    PackageExporter::Format format = PackageExporter::CsvFormat;
+    if (fileName.endsWith(QLatin1String(".json"), Qt::CaseInsensitive)
+            || (selectedFilter == jsonFilter && !fileName.endsWith(QLatin1String(".csv"), Qt::CaseInsensitive))) {
+        format = PackageExporter::JsonFormat;
+    }
+
+    // Exactly what the view shows: its rows in their order, and its columns
+    // as laid out in the header
+    QApt::PackageList packages;
+    packages.reserve(m_proxyModel->rowCount());
+    for (int row = 0; row < m_proxyModel->rowCount(); ++row) {
+        packages.append(m_proxyModel->packageAt(m_proxyModel->index(row, 0)));
+    }
+
+    QVector<int> columns;
+    QStringList titles;
+    QHeaderView *header = m_packageView->header();
+    for (int visual = 0; visual < header->count(); ++visual) {
+        const int column = header->logicalIndex(visual);
+        if (!header->isSectionHidden(column)) {
+            columns.append(column);
+            titles.append(m_model->headerData(column, Qt::Horizontal, Qt::DisplayRole).toString());
+        }
+    }
+
+    m_exportProgress = new QProgressDialog(i18nc("@label:progress", "Exporting packages..."),
+                                           i18nc("@action:button", "Cancel"), 0, packages.size(), this);
+    m_exportProgress->setWindowTitle(i18nc("@title:window", "Export Package List"));
+    m_exportProgress->setMinimumDuration(500);
+    m_exportProgress->setAutoClose(false);
+    connect(m_exporter, &PackageExporter::progressRangeChanged, m_exportProgress.data(), &QProgressDialog::setRange);
+    connect(m_exporter, &PackageExporter::progressValueChanged, m_exportProgress.data(), &QProgressDialog::setValue);
+    connect(m_exportProgress.data(), &QProgressDialog::canceled, m_exporter, &PackageExporter::cancel);
+    connect(m_exportProgress.data(), &QProgressDialog::canceled, m_exportProgress.data(), &QObject::deleteLater);
+
+    m_exporter->start(packages, columns, titles, fileName, format);
+}
+
+void PackageWidget::exportFinished(const QString &fileName, const QString &errorString)
+{
+    delete m_exportProgress;
+
+    if (!errorString.isEmpty()) {
+        KMessageBox::error(this, xi18nc("@label", "The package list could not be exported, as it was not "
+                                                  "possible to write to <filename>%1</filename>: %2",
+                                        fileName, errorString));
+    }
+}
+
+void PackageWidget::updateSelectionSummary()
+{
+    const SelectionSummary &summary = m_packageView->selectionSummary();
+    // A single package has its details shown already
+    if (summary.count < 2) {
+        m_selectionLabel->hide();
+        return;
+    }
+
+    m_selectionLabel->setText(i18ncp("@info:status %2 and %3 are package counts, %4 and %5 sizes",
+                                     "1 package selected (%2 installed, %3 upgradeable): %4 installed size, %5 to download",
+                                     "%1 packages selected (%2 installed, %3 upgradeable): %4 installed size, %5 to download",
+                                     summary.count, summary.installed, summary.upgradeable,
+                                     KFormat().formatByteSize(summary.installedSize),
+                                     KFormat().formatByteSize(summary.downloadSize)));
+    m_selectionLabel->show();
+}
+
 void PackageWidget::packageActivated(const QModelIndex &index)
 {
     QApt::Package *package = m_proxyModel->packageAt(index);
@@ -291,9 +426,54 @@ void PackageWidget::packageActivated(const QModelIndex &index)
         m_detailsWidget->hide();
         return;
     }
+
+    QVector<QApt::Package *> neighbours;
+    for (int row : { index.row() + 1, index.row() - 1 }) {
+        if (row >= 0 && row < m_proxyModel->rowCount()) {
+            neighbours.append(m_proxyModel->packageAt(m_proxyModel->index(row, 0)));
+        }
+    }
+    m_detailsWidget->setNeighbours(neighbours);
     m_detailsWidget->setPackage(package);
 }
 
+void PackageWidget::showPackage(const QString &name)
+{
+    QApt::Package *package = m_backend->package(name);
+    if (!package) {
+        return;
+    }
+
+    // Select the package if the list shows it, otherwise just show its details
+    const int row = m_model->packages().indexOf(package);
+    const QModelIndex index = row >= 0 ? m_proxyModel->mapFromSource(m_model->index(row, 0)) : QModelIndex();
+    if (!index.isValid()) {
+        m_detailsWidget->setPackage(package);
+        return;
+    }
+
+    m_packageView->setCurrentIndex(index);
+    m_packageView->scrollTo(index);
+}
+
+void PackageWidget::addInstallEstimate(QMenu *menu, QApt::Package *package)
+{
+    if (package->isInstalled()) {
+        return;
+    }
+
+    // The graph is built on first use, the next menu will have the estimate
+    DependencyGraphStore *store = DependencyGraphStore::self();
+    if (!store->isLoaded()) {
+        store->load();
+        return;
+    }
+
+    menu->addSeparator();
+    QAction *estimate = menu->addAction(DependencyGraph::estimateText(store->installEstimate(DependencyGraph::nodeName(package))));
+    estimate->setEnabled(false);
+}
+
 void PackageWidget::contextMenuRequested(const QPoint &pos)
 {
     QMenu menu;
@@ -377,6 +557,10 @@ void PackageWidget::contextMenuRequested(const QPoint &pos)
             m_lockAction->setText(i18nc("@action:button", "Lock at Current Version"));
             m_lockAction->setIcon(QIcon::fromTheme(QStringLiteral("object-locked")));
         }
+
+        if (m_installAction->isEnabled()) {
+            addInstallEstimate(&menu, m_proxyModel->packageAt(m_packageView->currentIndex()));
+        }
     } else {
         m_installAction->setEnabled(true);
         m_removeAction->setEnabled(true);
@@ -406,6 +590,13 @@ void PackageWidget::startSearch()
     }
 }
 
+void PackageWidget::fileIndexUpdated()
+{
+    if (m_searchEdit->text().startsWith(QLatin1String("file:"))) {
+        startSearch();
+    }
+}
+
 void PackageWidget::invalidateFilter()
 {
     if (m_proxyModel) {
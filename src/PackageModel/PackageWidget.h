@@ -24,18 +24,23 @@
 // Qt includes
 #include <QModelIndex>
 #include <QFutureWatcher>
+#include <QPointer>
 #include <QWidget>
 
 #include <QApt/Package>
 
 class QLabel;
 class QLineEdit;
+class QMenu;
+class QProgressDialog;
 class QTimer;
 class QVBoxLayout;
 
 class BusyIndicator;
 
 class DetailsWidget;
+class PackageDelegate;
+class PackageExporter;
 class PackageModel;
 class PackageProxyModel;
 class PackageView;
@@ -71,6 +76,7 @@ public:
 protected:
     QApt::Backend *m_backend;
     PackageView *m_packageView;
+    PackageDelegate *m_delegate;
     DetailsWidget *m_detailsWidget;
     PackageModel *m_model;
     PackageProxyModel *m_proxyModel;
@@ -82,6 +88,9 @@ private:
     QFutureWatcher<QList<QApt::Package*> >* m_watcher;
     QWidget *m_headerWidget;
     QLabel *m_headerLabel;
+    QLabel *m_selectionLabel;
+    PackageExporter *m_exporter;
+    QPointer<QProgressDialog> m_exportProgress;
     QLineEdit *m_searchEdit;
     QTimer *m_searchTimer;
 
@@ -98,6 +107,7 @@ private:
 
     void checkChanges();
     QApt::PackageList selectedPackages();
+    void addInstallEstimate(QMenu *menu, QApt::Package *package);
     QString digestReason(QApt::Package *pkg,
                          const QApt::MarkingErrorInfo &info);
     QString digestReason(QApt::Package *pkg,
@@ -112,13 +122,20 @@ public Q_SLOTS:
     void cacheReloadFinished();
     void setFocusSearchEdit();
     void startSearch();
+    void fileIndexUpdated();
     void invalidateFilter();
+    /** Asks for a file and exports the packages and columns shown to it */
+    void exportPackages();
 
 private Q_SLOTS:
     void setupActions();
     void packageActivated(const QModelIndex &index);
+    void updateSelectionSummary();
+    void exportFinished(const QString &fileName, const QString &errorString);
+    void showPackage(const QString &name);
     void contextMenuRequested(const QPoint &pos);
     void setSortedPackages();
+    void columnVisibilityChanged(int column, bool visible);
 
     bool confirmEssentialRemoval();
     void saveState();
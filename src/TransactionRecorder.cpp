@@ -0,0 +1,265 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "TransactionRecorder.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegularExpression>
+
+#include <QApt/DownloadProgress>
+#include <QApt/Transaction>
+
+// Track 0 holds the transaction status, anything dpkg says that can't be
+// pinned to a package goes to track 1
+constexpr int statusTrack = 0;
+constexpr int dpkgTrack = 1;
+
+static QString statusName(QApt::TransactionStatus status)
+{
+    switch (status) {
+    case QApt::SetupStatus:
+        return QStringLiteral("Setup");
+    case QApt::AuthenticationStatus:
+        return QStringLiteral("Authentication");
+    case QApt::WaitingStatus:
+        return QStringLiteral("Waiting");
+    case QApt::WaitingLockStatus:
+        return QStringLiteral("Waiting for lock");
+    case QApt::WaitingMediumStatus:
+        return QStringLiteral("Waiting for medium");
+    case QApt::WaitingConfigFilePromptStatus:
+        return QStringLiteral("Waiting for config file prompt");
+    case QApt::RunningStatus:
+        return QStringLiteral("Running");
+    case QApt::LoadingCacheStatus:
+        return QStringLiteral("Loading cache");
+    case QApt::DownloadingStatus:
+        return QStringLiteral("Downloading");
+    case QApt::CommittingStatus:
+        return QStringLiteral("Committing");
+    case QApt::FinishedStatus:
+        return QStringLiteral("Finished");
+    }
+
+    return QString();
+}
+
+TransactionRecorder::TransactionRecorder(QObject *parent)
+    : QObject(parent)
+    , m_statusSlice(-1)
+    , m_detailsSlice(-1)
+{
+}
+
+void TransactionRecorder::start(QApt::Transaction *trans)
+{
+    m_slices.clear();
+    m_progress.clear();
+    m_trackNames = QStringList { QStringLiteral("Transaction"), QStringLiteral("dpkg") };
+    m_trackForName.clear();
+    m_statusSlice = -1;
+    m_detailsSlice = -1;
+    m_downloadSlices.clear();
+    m_clock.start();
+
+    connect(trans, SIGNAL(statusChanged(QApt::TransactionStatus)),
+            this, SLOT(statusChanged(QApt::TransactionStatus)));
+    connect(trans, SIGNAL(statusDetailsChanged(QString)),
+            this, SLOT(statusDetailsChanged(QString)));
+    connect(trans, SIGNAL(progressChanged(int)),
+            this, SLOT(progressChanged(int)));
+    connect(trans, SIGNAL(downloadProgressChanged(QApt::DownloadProgress)),
+            this, SLOT(downloadProgressChanged(QApt::DownloadProgress)));
+
+    statusChanged(trans->status());
+}
+
+bool TransactionRecorder::isEmpty() const
+{
+    return m_slices.isEmpty();
+}
+
+qint64 TransactionRecorder::now() const
+{
+    // Trace timestamps are in microseconds
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+int TransactionRecorder::track(const QString &name)
+{
+    auto it = m_trackForName.constFind(name);
+    if (it != m_trackForName.constEnd()) {
+        return it.value();
+    }
+
+    const int track = m_trackNames.size();
+    m_trackNames.append(name);
+    m_trackForName.insert(name, track);
+    return track;
+}
+
+int TransactionRecorder::openSlice(const QString &name, const QString &category, int track)
+{
+    m_slices.append({ name, category, track, now(), -1 });
+    return m_slices.size() - 1;
+}
+
+void TransactionRecorder::closeSlice(int *slice)
+{
+    if (*slice != -1) {
+        m_slices[*slice].end = now();
+        *slice = -1;
+    }
+}
+
+void TransactionRecorder::statusChanged(QApt::TransactionStatus status)
+{
+    if (m_statusSlice != -1 && m_slices.at(m_statusSlice).name == statusName(status)) {
+        return;
+    }
+
+    closeSlice(&m_statusSlice);
+    closeSlice(&m_detailsSlice);
+
+    if (status == QApt::FinishedStatus) {
+        for (auto it = m_downloadSlices.begin(); it != m_downloadSlices.end(); ++it) {
+            closeSlice(&it.value());
+        }
+        m_downloadSlices.clear();
+
+        Q_EMIT finished();
+        return;
+    }
+
+    m_statusSlice = openSlice(statusName(status), QStringLiteral("status"), statusTrack);
+}
+
+void TransactionRecorder::statusDetailsChanged(const QString &details)
+{
+    closeSlice(&m_detailsSlice);
+
+    if (details.isEmpty()) {
+        return;
+    }
+
+    // dpkg progress comes through as "Unpacking foo (1.0)", "Configuring foo",
+    // "Running post-installation trigger man-db" and so on. apt translates
+    // these, so anything we don't recognize ends up on the dpkg track as is
+    static const QRegularExpression stepExpression(QStringLiteral(
+        "^(Preparing to configure|Preparing for removal of|Completely removing|Completely removed|"
+        "Running post-installation trigger|Processing triggers for|Setting up|"
+        "Preparing|Unpacking|Configuring|Installing|Installed|Removing|Removed)\\s+([^\\s:]+)"));
+    const QRegularExpressionMatch match = stepExpression.match(details);
+    if (!match.hasMatch()) {
+        m_detailsSlice = openSlice(details, QStringLiteral("dpkg"), dpkgTrack);
+        return;
+    }
+
+    const QString step = match.captured(1);
+    QString category;
+    if (step.contains(QLatin1String("trigger"))) {
+        category = QStringLiteral("trigger");
+    } else if (step.contains(QLatin1String("emov"))) {
+        category = QStringLiteral("remove");
+    } else if (step == QLatin1String("Preparing") || step == QLatin1String("Unpacking")
+               || step == QLatin1String("Installing")) {
+        category = QStringLiteral("unpack");
+    } else {
+        category = QStringLiteral("configure");
+    }
+
+    m_detailsSlice = openSlice(details, category, track(match.captured(2)));
+}
+
+void TransactionRecorder::progressChanged(int progress)
+{
+    if (m_progress.isEmpty() || m_progress.constLast().second != progress) {
+        m_progress.append({ now(), progress });
+    }
+}
+
+void TransactionRecorder::downloadProgressChanged(const QApt::DownloadProgress &progress)
+{
+    auto it = m_downloadSlices.find(progress.uri());
+    if (it == m_downloadSlices.end()) {
+        // Archive descriptions start with the package name
+        const QString package = progress.shortDescription().section(QLatin1Char(' '), 0, 0);
+        const int slice = openSlice(progress.shortDescription(), QStringLiteral("download"),
+                                    track(package.isEmpty() ? progress.uri() : package));
+        it = m_downloadSlices.insert(progress.uri(), slice);
+    }
+
+    if (progress.status() == QApt::DoneState || progress.status() == QApt::ErrorState) {
+        closeSlice(&it.value());
+    }
+}
+
+QJsonDocument TransactionRecorder::toTrace() const
+{
+    QJsonArray events;
+
+    for (int i = 0; i < m_trackNames.size(); ++i) {
+        events.append(QJsonObject {
+            { QStringLiteral("name"), QStringLiteral("thread_name") },
+            { QStringLiteral("ph"), QStringLiteral("M") },
+            { QStringLiteral("pid"), 1 },
+            { QStringLiteral("tid"), i },
+            { QStringLiteral("args"), QJsonObject { { QStringLiteral("name"), m_trackNames.at(i) } } }
+        });
+    }
+
+    const qint64 end = now();
+    for (const Slice &slice : m_slices) {
+        events.append(QJsonObject {
+            { QStringLiteral("name"), slice.name },
+            { QStringLiteral("cat"), slice.category },
+            { QStringLiteral("ph"), QStringLiteral("X") },
+            { QStringLiteral("pid"), 1 },
+            { QStringLiteral("tid"), slice.track },
+            { QStringLiteral("ts"), slice.start },
+            { QStringLiteral("dur"), (slice.end == -1 ? end : slice.end) - slice.start }
+        });
+    }
+
+    for (const auto &progress : m_progress) {
+        events.append(QJsonObject {
+            { QStringLiteral("name"), QStringLiteral("Progress") },
+            { QStringLiteral("ph"), QStringLiteral("C") },
+            { QStringLiteral("pid"), 1 },
+            { QStringLiteral("ts"), progress.first },
+            { QStringLiteral("args"), QJsonObject { { QStringLiteral("percent"), progress.second } } }
+        });
+    }
+
+    return QJsonDocument(QJsonObject {
+        { QStringLiteral("traceEvents"), events },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ms") }
+    });
+}
+
+bool TransactionRecorder::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    return file.write(toTrace().toJson(QJsonDocument::Compact)) != -1;
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef TRANSACTIONRECORDER_H
+#define TRANSACTIONRECORDER_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+#include <QApt/Globals>
+
+namespace QApt {
+    class DownloadProgress;
+    class Transaction;
+}
+
+/**
+ * Records the course of a transaction as a timeline, with one track for the
+ * transaction status and one for every package.
+ *
+ * Package tracks get a slice for the download of the package and one for every
+ * dpkg step reported through the status details, such as unpacking,
+ * configuring or running its triggers. The result is written in the Chrome
+ * trace event format, which Perfetto and chrome://tracing can open.
+ */
+class TransactionRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TransactionRecorder(QObject *parent = nullptr);
+
+    /** Drops the previous recording and starts following @p trans */
+    void start(QApt::Transaction *trans);
+
+    bool isEmpty() const;
+    QJsonDocument toTrace() const;
+    bool save(const QString &fileName) const;
+
+Q_SIGNALS:
+    /** Emitted once the transaction finished and all slices are closed */
+    void finished();
+
+private Q_SLOTS:
+    void statusChanged(QApt::TransactionStatus status);
+    void statusDetailsChanged(const QString &details);
+    void progressChanged(int progress);
+    void downloadProgressChanged(const QApt::DownloadProgress &progress);
+
+private:
+    struct Slice {
+        QString name;
+        QString category;
+        int track;
+        qint64 start;
+        qint64 end;
+    };
+
+    QElapsedTimer m_clock;
+    QVector<Slice> m_slices;
+    QVector<QPair<qint64, int>> m_progress;
+    QStringList m_trackNames;
+    QHash<QString, int> m_trackForName;
+
+    // Indexes into m_slices of the slices still running, or -1
+    int m_statusSlice;
+    int m_detailsSlice;
+    QHash<QString, int> m_downloadSlices;
+
+    qint64 now() const;
+    int track(const QString &name);
+    int openSlice(const QString &name, const QString &category, int track);
+    void closeSlice(int *slice);
+};
+
+#endif
@@ -21,8 +21,13 @@
 #include "TransactionWidget.h"
 
 // Qt includes
+#include <QtCore/QDateTime>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QStandardPaths>
 #include <QtCore/QStringBuilder>
+#include <QtCore/QTimer>
 #include <QtCore/QUuid>
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QLabel>
@@ -44,6 +49,32 @@
 #include "muonapt/MuonStrings.h"
 #include "DownloadModel/DownloadDelegate.h"
 #include "DownloadModel/DownloadModel.h"
+#include "DownloadModel/DownloadStatisticsWidget.h"
+#include "MuonSettings.h"
+#include "TransactionRecorder.h"
+
+// Returns a new file name for a transaction report of the given kind, or an
+// empty string if the directory for it can't be created
+static QString reportFileName(const QString &kind)
+{
+    // One file per transaction, so that runs can be compared
+    const QString dirName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                            % QLatin1Char('/') % kind;
+    if (!QDir().mkpath(dirName)) {
+        qWarning() << "Could not create" << dirName;
+        return QString();
+    }
+
+    // Two reports may well be written within the same millisecond
+    const QString baseName = dirName % QLatin1Char('/')
+                             % QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss-zzz"));
+    QString fileName = baseName % QLatin1String(".json");
+    for (int i = 1; QFile::exists(fileName); ++i) {
+        fileName = baseName % QLatin1Char('-') % QString::number(i) % QLatin1String(".json");
+    }
+
+    return fileName;
+}
 
 TransactionWidget::TransactionWidget(QWidget *parent)
     : QWidget(parent)
@@ -78,6 +109,18 @@ TransactionWidget::TransactionWidget(QWidget *parent)
     m_downloadView->header()->setSectionResizeMode(1, QHeaderView::Stretch);
     m_downloadView->hide();
 
+    m_statisticsWidget = new DownloadStatisticsWidget(this);
+    m_statisticsWidget->setStatistics(&m_statistics);
+    m_statisticsWidget->hide();
+    layout->addWidget(m_statisticsWidget);
+
+    m_recorder = new TransactionRecorder(this);
+    connect(m_recorder, SIGNAL(finished()), this, SLOT(saveTimeline()));
+
+    m_statisticsTimer = new QTimer(this);
+    m_statisticsTimer->setInterval(1000);
+    connect(m_statisticsTimer, SIGNAL(timeout()), m_statisticsWidget, SLOT(refresh()));
+
     QString uuid = QUuid::createUuid().toString();
     uuid.remove(QChar::fromLatin1('{')).remove(QChar::fromLatin1('}')).remove(QChar::fromLatin1('-'));
     m_pipe = QDir::tempPath() % QLatin1String("/qapt-sock-") % uuid;
@@ -134,6 +177,13 @@ void TransactionWidget::setTransaction(QApt::Transaction *trans)
             m_statusLabel, SLOT(setText(QString)));
     connect(m_trans, SIGNAL(downloadProgressChanged(QApt::DownloadProgress)),
             m_downloadModel, SLOT(updateDetails(QApt::DownloadProgress)));
+    connect(m_trans, SIGNAL(downloadProgressChanged(QApt::DownloadProgress)),
+            this, SLOT(downloadProgressChanged(QApt::DownloadProgress)));
+
+    m_statistics.start();
+    if (MuonSettings::self()->recordTransactionTimeline()) {
+        m_recorder->start(m_trans);
+    }
 
     // Connect us to the transaction
     connect(m_cancelButton, SIGNAL(clicked()), m_trans, SLOT(cancel()));
@@ -160,6 +210,7 @@ void TransactionWidget::statusChanged(QApt::TransactionStatus status)
         m_statusLabel->setText(i18nc("@info Status info",
                                      "Waiting for other transactions to finish"));
         m_totalProgress->setMaximum(0);
+        m_statistics.beginPhase(QStringLiteral("waiting"));
         break;
     case QApt::WaitingLockStatus:
         m_headerLabel->setText(xi18nc("@info Status information, widget title",
@@ -167,6 +218,7 @@ void TransactionWidget::statusChanged(QApt::TransactionStatus status)
         m_statusLabel->setText(i18nc("@info Status info",
                                      "Waiting for other software managers to quit"));
         m_totalProgress->setMaximum(0);
+        m_statistics.beginPhase(QStringLiteral("waiting"));
         break;
     case QApt::WaitingMediumStatus:
         m_headerLabel->setText(xi18nc("@info Status information, widget title",
@@ -191,10 +243,14 @@ void TransactionWidget::statusChanged(QApt::TransactionStatus status)
         m_statusLabel->clear();
         m_headerLabel->setText(xi18nc("@info Status info",
                                      "<title>Loading Software List</title>"));
+        m_statistics.beginPhase(QStringLiteral("loadingCache"));
         break;
     case QApt::DownloadingStatus:
         m_totalProgress->setMaximum(100);
         m_downloadView->show();
+        m_statisticsWidget->show();
+        m_statisticsTimer->start();
+        m_statistics.beginPhase(QStringLiteral("download"));
         switch (m_trans->role()) {
         case QApt::UpdateCacheRole:
             m_headerLabel->setText(xi18nc("@info Status information, widget title",
@@ -212,6 +268,9 @@ void TransactionWidget::statusChanged(QApt::TransactionStatus status)
     case QApt::CommittingStatus:
         m_totalProgress->setMaximum(100);
         m_downloadView->hide();
+        m_statisticsWidget->hide();
+        m_statisticsTimer->stop();
+        m_statistics.beginPhase(QStringLiteral("commit"));
         m_spacer->show();
 
         m_headerLabel->setText(xi18nc("@info Status information, widget title",
@@ -221,6 +280,12 @@ void TransactionWidget::statusChanged(QApt::TransactionStatus status)
         m_spacer->hide();
         m_downloadView->hide();
         m_downloadModel->clear();
+        m_statisticsWidget->hide();
+        m_statisticsTimer->stop();
+        m_statistics.beginPhase(QStringLiteral("finished"));
+        if (MuonSettings::self()->saveTransferStatistics()) {
+            saveStatistics();
+        }
         m_headerLabel->setText(xi18nc("@info Status information, widget title",
                                      "<title>Finished</title>"));
         m_lastRealProgress = 0;
@@ -309,3 +374,37 @@ void TransactionWidget::updateProgress(int progress)
         m_lastRealProgress = progress;
     }
 }
+
+void TransactionWidget::downloadProgressChanged(const QApt::DownloadProgress &progress)
+{
+    m_statistics.addProgress(progress);
+}
+
+void TransactionWidget::saveStatistics()
+{
+    if (m_statistics.isEmpty()) {
+        return;
+    }
+
+    QFile file(reportFileName(QStringLiteral("transfer-statistics")));
+    if (file.fileName().isEmpty() || !file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write transfer statistics to" << file.fileName();
+        return;
+    }
+
+    QJsonObject json = m_statistics.toJson();
+    json.insert(QStringLiteral("role"), int(m_trans->role()));
+    file.write(QJsonDocument(json).toJson());
+}
+
+void TransactionWidget::saveTimeline()
+{
+    if (m_recorder->isEmpty()) {
+        return;
+    }
+
+    const QString fileName = reportFileName(QStringLiteral("transaction-traces"));
+    if (fileName.isEmpty() || !m_recorder->save(fileName)) {
+        qWarning() << "Could not write the transaction timeline to" << fileName;
+    }
+}
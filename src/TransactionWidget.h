@@ -25,12 +25,16 @@
 
 #include <QApt/Globals>
 
+#include "DownloadModel/DownloadStatistics.h"
+
 class QLabel;
 class QProgressBar;
 class QPushButton;
+class QTimer;
 class QTreeView;
 
 namespace QApt {
+    class DownloadProgress;
     class Transaction;
 }
 
@@ -41,6 +45,8 @@ namespace QApt {
 
 class DownloadModel;
 class DownloadDelegate;
+class DownloadStatisticsWidget;
+class TransactionRecorder;
 
 class TransactionWidget : public QWidget
 {
@@ -61,6 +67,10 @@ private:
     QTreeView *m_downloadView;
     DownloadModel *m_downloadModel;
     DownloadDelegate *m_downloadDelegate;
+    DownloadStatistics m_statistics;
+    DownloadStatisticsWidget *m_statisticsWidget;
+    QTimer *m_statisticsTimer;
+    TransactionRecorder *m_recorder;
     //DebconfKde::DebconfGui *m_debconfGui;
     QProgressBar *m_totalProgress;
     QLabel *m_statusLabel;
@@ -73,6 +83,9 @@ private Q_SLOTS:
     void untrustedPrompt(const QStringList &untrustedPackages);
     void configFileConflict(const QString &currentPath, const QString &newPath);
     void updateProgress(int progress);
+    void downloadProgressChanged(const QApt::DownloadProgress &progress);
+    void saveStatistics();
+    void saveTimeline();
 };
 
 #endif // TRANSACTIONWIDGET_H
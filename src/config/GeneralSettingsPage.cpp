@@ -37,6 +37,9 @@ GeneralSettingsPage::GeneralSettingsPage(QWidget* parent, QApt::Config *aptConfi
         , m_aptConfig(aptConfig)
         , m_askChangesCheckBox(new QCheckBox(this))
         , m_multiArchDupesBox(new QCheckBox(this))
+        , m_transferStatisticsCheckBox(new QCheckBox(this))
+        , m_timelineCheckBox(new QCheckBox(this))
+        , m_prefetchChangelogsCheckBox(new QCheckBox(this))
         , m_recommendsCheckBox(new QCheckBox(this))
         , m_suggestsCheckBox(new QCheckBox(this))
         , m_untrustedCheckBox(new QCheckBox(this))
@@ -50,6 +53,9 @@ GeneralSettingsPage::GeneralSettingsPage(QWidget* parent, QApt::Config *aptConfi
 
     m_askChangesCheckBox->setText(i18n("Ask to confirm changes that affect other packages"));
     m_multiArchDupesBox->setText(i18n("Show foreign-architecture packages that are available natively"));
+    m_transferStatisticsCheckBox->setText(i18n("Save download statistics after each transaction"));
+    m_timelineCheckBox->setText(i18n("Save a timeline of each transaction for profiling"));
+    m_prefetchChangelogsCheckBox->setText(i18n("Download the changes lists of upgrades in the background"));
     m_recommendsCheckBox->setText(i18n("Treat recommended packages as dependencies"));
     m_suggestsCheckBox->setText(i18n("Treat suggested packages as dependencies"));
     m_untrustedCheckBox->setText(i18n("Allow the installation of untrusted packages"));
@@ -78,6 +84,9 @@ GeneralSettingsPage::GeneralSettingsPage(QWidget* parent, QApt::Config *aptConfi
 
     layout->addRow(m_askChangesCheckBox);
     layout->addRow(m_multiArchDupesBox);
+    layout->addRow(m_transferStatisticsCheckBox);
+    layout->addRow(m_timelineCheckBox);
+    layout->addRow(m_prefetchChangelogsCheckBox);
     layout->addRow(m_recommendsCheckBox);
     layout->addRow(m_suggestsCheckBox);
     layout->addRow(m_untrustedCheckBox);
@@ -87,6 +96,9 @@ GeneralSettingsPage::GeneralSettingsPage(QWidget* parent, QApt::Config *aptConfi
 
     connect(m_askChangesCheckBox, SIGNAL(clicked()), this, SIGNAL(changed()));
     connect(m_multiArchDupesBox, SIGNAL(clicked()), this, SIGNAL(changed()));
+    connect(m_transferStatisticsCheckBox, SIGNAL(clicked()), this, SIGNAL(changed()));
+    connect(m_timelineCheckBox, SIGNAL(clicked()), this, SIGNAL(changed()));
+    connect(m_prefetchChangelogsCheckBox, SIGNAL(clicked()), this, SIGNAL(changed()));
     connect(m_recommendsCheckBox, SIGNAL(clicked()), this, SLOT(emitAuthChanged()));
     connect(m_suggestsCheckBox, SIGNAL(clicked()), this, SLOT(emitAuthChanged()));
     connect(m_untrustedCheckBox, SIGNAL(clicked()), this, SLOT(emitAuthChanged()));
@@ -111,6 +123,9 @@ void GeneralSettingsPage::loadSettings()
 
     m_askChangesCheckBox->setChecked(settings->askChanges());
     m_multiArchDupesBox->setChecked(settings->showMultiArchDupes());
+    m_transferStatisticsCheckBox->setChecked(settings->saveTransferStatistics());
+    m_timelineCheckBox->setChecked(settings->recordTransactionTimeline());
+    m_prefetchChangelogsCheckBox->setChecked(settings->prefetchChangelogs());
     m_recommendsCheckBox->setChecked(m_aptConfig->readEntry(QStringLiteral("APT::Install-Recommends"), true));
     m_suggestsCheckBox->setChecked(m_aptConfig->readEntry(QStringLiteral("APT::Install-Suggests"), false));
     m_untrustedCheckBox->setChecked(m_aptConfig->readEntry(QStringLiteral("APT::Get::AllowUnauthenticated"), false));
@@ -127,6 +142,9 @@ void GeneralSettingsPage::applySettings()
 
     settings->setAskChanges(m_askChangesCheckBox->isChecked());
     settings->setShowMultiArchDupes(m_multiArchDupesBox->isChecked());
+    settings->setSaveTransferStatistics(m_transferStatisticsCheckBox->isChecked());
+    settings->setRecordTransactionTimeline(m_timelineCheckBox->isChecked());
+    settings->setPrefetchChangelogs(m_prefetchChangelogsCheckBox->isChecked());
     settings->setUndoStackSize(m_undoStackSpinbox->value());
     settings->save();
 
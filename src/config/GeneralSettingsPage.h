@@ -52,6 +52,9 @@ private:
     QApt::Config *m_aptConfig;
     QCheckBox *m_askChangesCheckBox;
     QCheckBox *m_multiArchDupesBox;
+    QCheckBox *m_transferStatisticsCheckBox;
+    QCheckBox *m_timelineCheckBox;
+    QCheckBox *m_prefetchChangelogsCheckBox;
     QCheckBox *m_recommendsCheckBox;
     QCheckBox *m_suggestsCheckBox;
     QCheckBox *m_untrustedCheckBox;
@@ -0,0 +1,406 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "AppStreamIcons.h"
+
+#include <algorithm>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QIcon>
+#include <QImageReader>
+#include <QtConcurrentRun>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include <QtCore/QStringBuilder>
+#include <QtCore/QXmlStreamReader>
+
+// KDE includes
+#include <KCompressionDevice>
+
+// Directories holding AppStream catalogs, most current layout first
+static const char *const catalogRoots[] = {
+    "/var/lib/swcatalog",
+    "/usr/share/swcatalog",
+    "/var/lib/app-info",
+    "/usr/share/app-info"
+};
+// Decoded icons kept around, enough for a few screens of package rows
+constexpr int cachedIconCount = 512;
+// Icons waiting for decoding. Older requests are dropped first, as the rows
+// asking for them have most likely been scrolled away
+constexpr int maximumQueuedIcons = 128;
+// Icons decoding at the same time
+constexpr int maximumDecodes = 2;
+// Smallest icon size preferred from the icon caches, as rows scale them down
+constexpr int preferredIconSize = 48;
+
+AppStreamIcons::AppStreamIcons(QObject *parent)
+    : QObject(parent)
+    , m_loaded(false)
+    , m_watcher(new QFutureWatcher<IndexResult>(this))
+    , m_pixmaps(cachedIconCount)
+{
+    m_pool.setMaxThreadCount(maximumDecodes);
+    m_pool.setThreadPriority(QThread::LowPriority);
+    connect(m_watcher, &QFutureWatcher<IndexResult>::finished, this, &AppStreamIcons::indexFinished);
+}
+
+AppStreamIcons *AppStreamIcons::self()
+{
+    static QPointer<AppStreamIcons> self;
+    if (!self) {
+        self = new AppStreamIcons(QCoreApplication::instance());
+    }
+    return self;
+}
+
+bool AppStreamIcons::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool AppStreamIcons::hasIcon(const QString &packageName) const
+{
+    return m_index.contains(packageName);
+}
+
+QString AppStreamIcons::pixmapKey(const QString &packageName, int size)
+{
+    return packageName % QLatin1Char('@') % QString::number(size);
+}
+
+QPixmap AppStreamIcons::icon(const QString &packageName, int size)
+{
+    auto it = m_index.constFind(packageName);
+    if (it == m_index.constEnd()) {
+        return QPixmap();
+    }
+
+    const QString key = pixmapKey(packageName, size);
+    if (const QPixmap *pixmap = m_pixmaps.object(key)) {
+        return *pixmap;
+    }
+
+    // Themed icons come from the icon loader, which caches them itself
+    if (it->path.isEmpty()) {
+        auto *pixmap = new QPixmap(QIcon::fromTheme(it->stockName).pixmap(QSize(size, size), 1.0));
+        m_pixmaps.insert(key, pixmap);
+        return *pixmap;
+    }
+
+    if (!m_decoding.contains(key)) {
+        m_queue.removeOne(key);
+        m_queue.append(key);
+        while (m_queue.size() > maximumQueuedIcons) {
+            m_queue.removeFirst();
+        }
+        decodeNext();
+    }
+
+    return QPixmap();
+}
+
+void AppStreamIcons::decodeNext()
+{
+    while (m_decoding.size() < maximumDecodes && !m_queue.isEmpty()) {
+        // Newest first, that is what is on screen right now
+        const QString key = m_queue.takeLast();
+        const int separator = key.lastIndexOf(QLatin1Char('@'));
+        const QString packageName = key.left(separator);
+        const int size = key.mid(separator + 1).toInt();
+        const QString path = m_index.value(packageName).path;
+
+        m_decoding.insert(key);
+        auto *watcher = new QFutureWatcher<QImage>(this);
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, packageName]() {
+            watcher->deleteLater();
+            if (!m_decoding.remove(key)) {
+                // The index got reloaded meanwhile
+                return;
+            }
+
+            // Icons that fail to decode are cached as null pixmaps, so they
+            // keep showing the generic icon instead of being retried
+            m_pixmaps.insert(key, new QPixmap(QPixmap::fromImage(watcher->result())));
+            Q_EMIT iconReady(packageName);
+            decodeNext();
+        });
+        watcher->setFuture(QtConcurrent::run(&m_pool, [path, size]() {
+            QImageReader reader(path);
+            const QSize imageSize = reader.size();
+            if (imageSize.isValid()) {
+                reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+            }
+            return reader.read();
+        }));
+    }
+}
+
+void AppStreamIcons::load()
+{
+    if (m_watcher->isRunning()) {
+        return;
+    }
+
+    m_watcher->setFuture(QtConcurrent::run(&AppStreamIcons::buildIndex, m_catalogs));
+}
+
+void AppStreamIcons::indexFinished()
+{
+    const IndexResult result = m_watcher->result();
+    // Most reloads follow transactions that touched no catalog, so the icons
+    // decoded so far are as good as ever
+    if (m_loaded && !result.changed) {
+        return;
+    }
+
+    m_index = result.index;
+    m_catalogs = result.catalogs;
+    m_loaded = true;
+    m_pixmaps.clear();
+    m_queue.clear();
+    m_decoding.clear();
+
+    Q_EMIT loaded();
+}
+
+AppStreamIcons::IndexResult AppStreamIcons::buildIndex(const CatalogTimes &previous)
+{
+    IndexResult result;
+    // Catalogs to read, in order
+    struct Catalog {
+        QString path;
+        QString iconRoot;
+        bool yaml;
+    };
+    QVector<Catalog> catalogs;
+
+    for (const char *root : catalogRoots) {
+        const QString rootPath = QString::fromLatin1(root);
+        const QString iconRoot = rootPath % QLatin1String("/icons");
+        const QStringList directories = {
+            rootPath % QLatin1String("/yaml"),
+            rootPath % QLatin1String("/xml"),
+            rootPath % QLatin1String("/xmls")
+        };
+
+        for (const QString &directory : directories) {
+            const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files, QDir::Name);
+            for (const QFileInfo &info : files) {
+                // The same catalog is often linked into several of the directories
+                const QString path = info.canonicalFilePath();
+                if (path.isEmpty() || result.catalogs.contains(path)) {
+                    continue;
+                }
+                if (!info.fileName().contains(QLatin1String(".yml")) && !info.fileName().contains(QLatin1String(".xml"))) {
+                    continue;
+                }
+                result.catalogs.insert(path, info.lastModified().toMSecsSinceEpoch());
+                catalogs.append({ path, iconRoot, info.fileName().contains(QLatin1String(".yml")) });
+            }
+        }
+    }
+
+    result.changed = result.catalogs != previous;
+    if (!result.changed) {
+        return result;
+    }
+
+    for (const Catalog &catalog : std::as_const(catalogs)) {
+        if (catalog.yaml) {
+            readYamlCatalog(catalog.path, catalog.iconRoot, &result.index);
+        } else {
+            readXmlCatalog(catalog.path, catalog.iconRoot, &result.index);
+        }
+    }
+
+    return result;
+}
+
+// @returns the value of a "key: value" line, without any quotes
+static QString yamlValue(const QByteArray &line)
+{
+    QByteArray value = line.mid(line.indexOf(':') + 1).trimmed();
+    if (value.size() >= 2 && (value.startsWith('\'') || value.startsWith('"'))) {
+        value = value.mid(1, value.size() - 2);
+    }
+    return QString::fromUtf8(value);
+}
+
+void AppStreamIcons::readYamlCatalog(const QString &path, const QString &iconRoot, IconIndex *index)
+{
+    KCompressionDevice device(path);
+    if (!device.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // DEP-11 is a stream of YAML documents: a header naming the origin, then
+    // one document per component. Only a handful of keys matter here, so
+    // this reads lines rather than parsing YAML
+    QString origin;
+    QString package;
+    QString stockName;
+    QList<QPair<int, QString>> cachedIcons;
+    bool inIcon = false;
+    QByteArray iconSection;
+
+    auto addComponent = [&]() {
+        if (!package.isEmpty() && !index->contains(package)) {
+            const QString iconPath = cachedIconPath(iconRoot, origin, cachedIcons);
+            if (!iconPath.isEmpty() || !stockName.isEmpty()) {
+                index->insert(package, { iconPath, stockName });
+            }
+        }
+        package.clear();
+        stockName.clear();
+        cachedIcons.clear();
+        inIcon = false;
+    };
+
+    while (!device.atEnd()) {
+        const QByteArray line = device.readLine();
+        if (line.startsWith("---")) {
+            addComponent();
+            continue;
+        }
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+
+        if (line.at(0) != ' ' && line.at(0) != '-') {
+            inIcon = line.startsWith("Icon:");
+            iconSection.clear();
+            if (line.startsWith("Origin:")) {
+                origin = yamlValue(line);
+            } else if (line.startsWith("Package:")) {
+                package = yamlValue(line);
+            }
+            continue;
+        }
+        if (!inIcon) {
+            continue;
+        }
+
+        QByteArray item = line.trimmed();
+        const bool listItem = item.startsWith("- ");
+        if (listItem) {
+            item = item.mid(2);
+        }
+
+        if (!listItem && line.startsWith("  ") && line.at(2) != ' ') {
+            // cached, remote, local or stock
+            iconSection = item.left(item.indexOf(':'));
+            if (iconSection == "stock") {
+                stockName = yamlValue(item);
+            } else if (iconSection == "cached" && !yamlValue(item).isEmpty()) {
+                // Old style, a single 64x64 icon
+                cachedIcons.append({ 64, yamlValue(item) });
+            }
+        } else if (iconSection == "cached") {
+            if (item.startsWith("name:")) {
+                cachedIcons.append({ 0, yamlValue(item) });
+            } else if (item.startsWith("width:") && !cachedIcons.isEmpty()) {
+                cachedIcons.last().first = yamlValue(item).toInt();
+            }
+        }
+    }
+    addComponent();
+}
+
+void AppStreamIcons::readXmlCatalog(const QString &path, const QString &iconRoot, IconIndex *index)
+{
+    KCompressionDevice device(path);
+    if (!device.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QXmlStreamReader reader(&device);
+    QString origin;
+    QString package;
+    QString stockName;
+    QList<QPair<int, QString>> cachedIcons;
+
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            if (reader.name() == QLatin1String("components")) {
+                origin = reader.attributes().value(QLatin1String("origin")).toString();
+            } else if (reader.name() == QLatin1String("component")) {
+                package.clear();
+                stockName.clear();
+                cachedIcons.clear();
+            } else if (reader.name() == QLatin1String("pkgname")) {
+                package = reader.readElementText();
+            } else if (reader.name() == QLatin1String("icon")) {
+                const QXmlStreamAttributes attributes = reader.attributes();
+                const QStringView type = attributes.value(QLatin1String("type"));
+                const int width = attributes.value(QLatin1String("width")).toInt();
+                const QString name = reader.readElementText();
+                if (type == QLatin1String("stock")) {
+                    stockName = name;
+                } else if (type == QLatin1String("cached")) {
+                    cachedIcons.append({ width ? width : 64, name });
+                }
+            }
+            break;
+        case QXmlStreamReader::EndElement:
+            if (reader.name() == QLatin1String("component") && !package.isEmpty() && !index->contains(package)) {
+                const QString iconPath = cachedIconPath(iconRoot, origin, cachedIcons);
+                if (!iconPath.isEmpty() || !stockName.isEmpty()) {
+                    index->insert(package, { iconPath, stockName });
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+QString AppStreamIcons::cachedIconPath(const QString &iconRoot, const QString &origin,
+                                       const QList<QPair<int, QString>> &icons)
+{
+    if (origin.isEmpty() || icons.isEmpty()) {
+        return QString();
+    }
+
+    // The smallest icon that is big enough, then the biggest of the rest
+    QList<QPair<int, QString>> candidates = icons;
+    std::sort(candidates.begin(), candidates.end(), [](const QPair<int, QString> &a, const QPair<int, QString> &b) {
+        const bool aBigEnough = a.first >= preferredIconSize;
+        const bool bBigEnough = b.first >= preferredIconSize;
+        if (aBigEnough != bBigEnough) {
+            return aBigEnough;
+        }
+        return aBigEnough ? a.first < b.first : a.first > b.first;
+    });
+
+    for (const auto &candidate : std::as_const(candidates)) {
+        const QString size = QString::number(candidate.first);
+        const QString path = iconRoot % QLatin1Char('/') % origin % QLatin1Char('/')
+                % size % QLatin1Char('x') % size % QLatin1Char('/') % candidate.second;
+        if (QFileInfo::exists(path)) {
+            return path;
+        }
+    }
+
+    return QString();
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef APPSTREAMICONS_H
+#define APPSTREAMICONS_H
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QFutureWatcher>
+#include <QPixmap>
+
+/**
+ * Application icons of packages, taken from the AppStream metadata that apt
+ * downloads: the DEP-11 YAML and AppStream XML catalogs below /var/lib/app-info,
+ * /usr/share/app-info and their swcatalog successors, together with the icon
+ * caches extracted next to them.
+ *
+ * The catalogs are read once, in the background, into an index from package
+ * names to icons. Reloading only reads them again if they changed. Icons are decoded on a worker thread into a small LRU cache
+ * of pixmaps, so asking for one never waits for the disk: if it is not cached
+ * yet, icon() returns a null pixmap and iconReady() follows once it is.
+ */
+class AppStreamIcons : public QObject
+{
+    Q_OBJECT
+public:
+    static AppStreamIcons *self();
+
+    bool isLoaded() const;
+    /** @returns whether the metadata has an icon for @p packageName */
+    bool hasIcon(const QString &packageName) const;
+    /**
+     * @returns the icon of @p packageName at @p size device pixels, or a null
+     * pixmap if it has none or it is still being decoded
+     */
+    QPixmap icon(const QString &packageName, int size);
+
+public Q_SLOTS:
+    /** (Re)reads the AppStream catalogs in the background, if they changed since the last read */
+    void load();
+
+Q_SIGNALS:
+    void loaded();
+    void iconReady(const QString &packageName);
+
+private Q_SLOTS:
+    void indexFinished();
+
+private:
+    explicit AppStreamIcons(QObject *parent);
+
+    // Either an icon file from an AppStream icon cache, or a themed icon
+    struct IconSource {
+        QString path;
+        QString stockName;
+    };
+    using IconIndex = QHash<QString, IconSource>;
+    // Modification times of the catalogs, in msecs since the epoch, by path
+    using CatalogTimes = QHash<QString, qint64>;
+
+    struct IndexResult {
+        CatalogTimes catalogs;
+        IconIndex index;
+        bool changed;
+    };
+
+    IconIndex m_index;
+    CatalogTimes m_catalogs;
+    bool m_loaded;
+    QFutureWatcher<IndexResult> *m_watcher;
+
+    QCache<QString, QPixmap> m_pixmaps;
+    QThreadPool m_pool;
+    // Icons waiting to be decoded, newest last, and those already decoding
+    QStringList m_queue;
+    QSet<QString> m_decoding;
+
+    void decodeNext();
+
+    static QString pixmapKey(const QString &packageName, int size);
+    static IndexResult buildIndex(const CatalogTimes &previous);
+    static void readYamlCatalog(const QString &path, const QString &iconRoot, IconIndex *index);
+    static void readXmlCatalog(const QString &path, const QString &iconRoot, IconIndex *index);
+    static QString cachedIconPath(const QString &iconRoot, const QString &origin,
+                                  const QList<QPair<int, QString>> &icons);
+};
+
+#endif
@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "ChangelogCache.h"
+
+#include <algorithm>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QStringBuilder>
+
+// KDE includes
+#include <KIO/StoredTransferJob>
+
+// QApt includes
+#include <QApt/Package>
+
+// Upper bound for the disk space taken by cached changelogs
+constexpr qint64 maximumCacheSize = 32 * 1024 * 1024;
+// Number of prefetch downloads running at the same time. There is at most
+// one on-demand download on top of these
+constexpr int maximumPrefetchJobs = 2;
+// Milliseconds an on-demand fetch waits for being superseded before starting
+constexpr int fetchDelay = 150;
+
+QString ChangelogRequest::key() const
+{
+    // Epochs use ':', which is fine in file names but keep them tidy anyway
+    QString fileVersion = version;
+    fileVersion.replace(QLatin1Char(':'), QLatin1Char('%'));
+    return sourcePackage % QLatin1Char('_') % fileVersion;
+}
+
+ChangelogRequest ChangelogRequest::forPackage(QApt::Package *package)
+{
+    return { package->sourcePackage(), package->availableVersion(), package->changelogUrl() };
+}
+
+ChangelogCache::ChangelogCache(QObject *parent)
+    : QObject(parent)
+    , m_directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % QLatin1String("/changelogs"))
+    , m_totalSize(0)
+    , m_indexed(false)
+    , m_currentJob(nullptr)
+{
+    m_fetchTimer.setSingleShot(true);
+    m_fetchTimer.setInterval(fetchDelay);
+    connect(&m_fetchTimer, &QTimer::timeout, this, &ChangelogCache::startPendingFetch);
+}
+
+ChangelogCache *ChangelogCache::self()
+{
+    static QPointer<ChangelogCache> self;
+    if (!self) {
+        self = new ChangelogCache(QCoreApplication::instance());
+    }
+    return self;
+}
+
+QString ChangelogCache::filePath(const QString &key) const
+{
+    return m_directory % QLatin1Char('/') % key;
+}
+
+void ChangelogCache::ensureIndexed()
+{
+    if (m_indexed) {
+        return;
+    }
+
+    QDir().mkpath(m_directory);
+
+    // The modification time doubles as the time of last use
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo &info : files) {
+        m_entries.insert(info.fileName(), { info.size(), info.lastModified() });
+        m_totalSize += info.size();
+    }
+
+    m_indexed = true;
+}
+
+bool ChangelogCache::contains(const QString &key)
+{
+    ensureIndexed();
+    return m_entries.contains(key);
+}
+
+QString ChangelogCache::changelogPath(const QString &key)
+{
+    ensureIndexed();
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return QString();
+    }
+
+    const QString path = filePath(key);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        // Somebody cleaned up behind our back
+        m_totalSize -= it->size;
+        m_entries.erase(it);
+        return QString();
+    }
+
+    it->lastUsed = QDateTime::currentDateTime();
+    file.setFileTime(it->lastUsed, QFileDevice::FileModificationTime);
+
+    return path;
+}
+
+void ChangelogCache::insert(const QString &key, const QByteArray &data)
+{
+    ensureIndexed();
+
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        file.remove();
+        return;
+    }
+
+    auto it = m_entries.constFind(key);
+    if (it != m_entries.constEnd()) {
+        m_totalSize -= it->size;
+    }
+    m_entries.insert(key, { data.size(), QDateTime::currentDateTime() });
+    m_totalSize += data.size();
+
+    evict();
+}
+
+void ChangelogCache::evict()
+{
+    if (m_totalSize <= maximumCacheSize) {
+        return;
+    }
+
+    QVector<QPair<QDateTime, QString>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        byAge.append({ it->lastUsed, it.key() });
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    for (const auto &entry : std::as_const(byAge)) {
+        if (m_totalSize <= maximumCacheSize) {
+            break;
+        }
+
+        QFile::remove(filePath(entry.second));
+        m_totalSize -= m_entries.value(entry.second).size;
+        m_entries.remove(entry.second);
+    }
+}
+
+KJob *ChangelogCache::startJob(const ChangelogRequest &request)
+{
+    KIO::StoredTransferJob *job = KIO::storedGet(request.url, KIO::NoReload, KIO::HideProgressInfo);
+    connect(job, &KJob::result, this, &ChangelogCache::jobFinished);
+
+    m_jobs.insert(job, request.key());
+    m_jobForKey.insert(request.key(), job);
+    return job;
+}
+
+void ChangelogCache::fetch(const ChangelogRequest &request)
+{
+    m_currentKey = request.key();
+
+    if (contains(m_currentKey)) {
+        m_fetchTimer.stop();
+        cancelSupersededJob();
+        Q_EMIT changelogFetched(m_currentKey);
+        return;
+    }
+
+    // Already on its way, most likely prefetching
+    if (KJob *job = m_jobForKey.value(m_currentKey)) {
+        m_fetchTimer.stop();
+        cancelSupersededJob();
+        m_currentJob = job;
+        return;
+    }
+
+    m_pendingRequest = request;
+    m_fetchTimer.start();
+}
+
+void ChangelogCache::cancelFetch()
+{
+    m_fetchTimer.stop();
+    m_currentKey.clear();
+    cancelSupersededJob();
+}
+
+void ChangelogCache::startPendingFetch()
+{
+    if (m_pendingRequest.key() != m_currentKey) {
+        return;
+    }
+
+    cancelSupersededJob();
+    if (m_jobForKey.contains(m_currentKey)) {
+        m_currentJob = m_jobForKey.value(m_currentKey);
+        return;
+    }
+
+    m_currentJob = startJob(m_pendingRequest);
+}
+
+void ChangelogCache::cancelSupersededJob()
+{
+    if (!m_currentJob || m_jobs.value(m_currentJob) == m_currentKey) {
+        return;
+    }
+
+    // Prefetches are left to finish, they are wanted either way
+    if (!m_prefetchJobs.contains(m_currentJob)) {
+        m_jobForKey.remove(m_jobs.take(m_currentJob));
+        m_currentJob->kill();
+    }
+
+    m_currentJob = nullptr;
+}
+
+void ChangelogCache::prefetch(const QList<ChangelogRequest> &requests)
+{
+    // Whatever is still queued is of an older list of upgrades
+    m_prefetchQueue.clear();
+    QSet<QString> queued;
+    for (const ChangelogRequest &request : requests) {
+        const QString key = request.key();
+        if (!request.url.isEmpty() && !queued.contains(key) && !contains(key) && !m_jobForKey.contains(key)) {
+            queued.insert(key);
+            m_prefetchQueue.append(request);
+        }
+    }
+
+    startPrefetchJobs();
+}
+
+void ChangelogCache::cancelPrefetch()
+{
+    m_prefetchQueue.clear();
+}
+
+void ChangelogCache::startPrefetchJobs()
+{
+    while (m_prefetchJobs.size() < maximumPrefetchJobs && !m_prefetchQueue.isEmpty()) {
+        const ChangelogRequest request = m_prefetchQueue.takeFirst();
+        // Might have been fetched on demand in the meantime
+        if (contains(request.key()) || m_jobForKey.contains(request.key())) {
+            continue;
+        }
+
+        m_prefetchJobs.insert(startJob(request));
+    }
+}
+
+void ChangelogCache::jobFinished(KJob *job)
+{
+    const bool prefetched = m_prefetchJobs.remove(job);
+    const QString key = m_jobs.take(job);
+    m_jobForKey.remove(key);
+    if (job == m_currentJob) {
+        m_currentJob = nullptr;
+    }
+
+    if (job->error()) {
+        Q_EMIT fetchFailed(key);
+    } else {
+        insert(key, static_cast<KIO::StoredTransferJob *>(job)->data());
+        Q_EMIT changelogFetched(key);
+    }
+
+    if (prefetched) {
+        startPrefetchJobs();
+    }
+}
@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef CHANGELOGCACHE_H
+#define CHANGELOGCACHE_H
+
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
+#include <QtCore/QUrl>
+
+class KJob;
+
+namespace QApt {
+    class Package;
+}
+
+/**
+ * Where to get the changelog of one version of a source package
+ */
+struct ChangelogRequest
+{
+    QString sourcePackage;
+    QString version;
+    QUrl url;
+
+    QString key() const;
+    static ChangelogRequest forPackage(QApt::Package *package);
+};
+
+/**
+ * Size-bounded on-disk cache of downloaded changelogs, keyed by source
+ * package and version. The least recently used changelogs are dropped
+ * first once the cache grows too big.
+ *
+ * Besides fetching changelogs on demand, the cache can prefetch a list of
+ * them in the background, a few at a time. Only one on-demand fetch is kept
+ * alive: asking for another changelog cancels the previous one, and requests
+ * for a changelog that is already being downloaded share that download.
+ */
+class ChangelogCache : public QObject
+{
+    Q_OBJECT
+public:
+    static ChangelogCache *self();
+
+    bool contains(const QString &key);
+    /**
+     * Marks the changelog for @p key as used, so that it is kept longer.
+     * @returns the file holding it, which callers read themselves and may
+     * do so off the GUI thread, or an empty string if it is not cached
+     */
+    QString changelogPath(const QString &key);
+    void insert(const QString &key, const QByteArray &data);
+
+    /**
+     * Makes @p request the changelog wanted right now. Cached changelogs are
+     * reported right away, others are downloaded after a short delay, so that
+     * quickly moving through a list only downloads where the user stops.
+     */
+    void fetch(const ChangelogRequest &request);
+    /** Cancels the on-demand fetch, if any */
+    void cancelFetch();
+    /**
+     * Replaces the prefetch queue with the changelogs of @p requests that are
+     * neither cached nor being downloaded yet
+     */
+    void prefetch(const QList<ChangelogRequest> &requests);
+    void cancelPrefetch();
+
+Q_SIGNALS:
+    void changelogFetched(const QString &key);
+    void fetchFailed(const QString &key);
+
+private Q_SLOTS:
+    void jobFinished(KJob *job);
+    void startPendingFetch();
+
+private:
+    explicit ChangelogCache(QObject *parent);
+
+    struct Entry {
+        qint64 size;
+        QDateTime lastUsed;
+    };
+
+    QString m_directory;
+    QHash<QString, Entry> m_entries;
+    qint64 m_totalSize;
+    bool m_indexed;
+
+    QList<ChangelogRequest> m_prefetchQueue;
+    // All running downloads, by job and by key
+    QHash<KJob *, QString> m_jobs;
+    QHash<QString, KJob *> m_jobForKey;
+    QSet<KJob *> m_prefetchJobs;
+
+    // The on-demand request, waiting to start or running as m_currentJob
+    ChangelogRequest m_pendingRequest;
+    QString m_currentKey;
+    KJob *m_currentJob;
+    QTimer m_fetchTimer;
+
+    void ensureIndexed();
+    void evict();
+    void startPrefetchJobs();
+    KJob *startJob(const ChangelogRequest &request);
+    void cancelSupersededJob();
+    QString filePath(const QString &key) const;
+};
+
+#endif
@@ -0,0 +1,698 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "ContentsIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QtConcurrentRun>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include <QtCore/QProcess>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QStringBuilder>
+
+// KDE includes
+#include <KCompressionDevice>
+
+// Bumped whenever the layout below changes
+constexpr quint32 segmentVersion = 1;
+constexpr char segmentMagic[8] = { 'M', 'U', 'O', 'N', 'C', 'I', 'D', 'X' };
+// Paths per front-coded block. Every block starts with a full path, so this
+// trades size against the amount of decoding behind every lookup
+constexpr int blockSize = 32;
+// Set when the paths of a list turned out not to be sorted
+constexpr quint32 unsortedFlag = 0x1;
+// Paths a search decodes between two checks for being superseded
+constexpr int searchCheckInterval = 4096;
+
+/*
+ * A segment is laid out as the header, the blocks of paths, the offsets of the
+ * blocks, the offsets of the owner strings and the owner strings themselves.
+ *
+ * Within a block every path is stored as the length of the prefix it shares
+ * with the previous path, the remaining suffix and the id of its owner field.
+ * The first path of a block shares nothing. Numbers are LEB128 varints, the
+ * tables are in host byte order.
+ */
+struct SegmentHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 flags;
+    qint64 listModified;  // Modification time of the list, in msecs since the epoch
+    qint64 listSize;
+    quint32 entryCount;
+    quint32 blockCount;
+    quint32 ownerCount;
+    quint32 reserved;
+    quint64 blockOffsetsOffset;  // quint64 per block, relative to the end of the header
+    quint64 ownerOffsetsOffset;  // quint32 per owner plus one, relative to the owner pool
+    quint64 ownerPoolOffset;
+    quint64 fileSize;
+};
+
+static void writeVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static quint32 readVarint(const uchar *&p, const uchar *end)
+{
+    quint32 value = 0;
+    for (int shift = 0; p < end && shift < 32; shift += 7) {
+        const uchar byte = *p++;
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+namespace {
+
+// Read-only view of a mapped segment
+class SegmentView
+{
+public:
+    SegmentView(const uchar *data, qint64 size)
+        : m_header(nullptr)
+        , m_data(data)
+    {
+        if (!data || size < qint64(sizeof(SegmentHeader))) {
+            return;
+        }
+
+        const auto *header = reinterpret_cast<const SegmentHeader *>(data);
+        if (memcmp(header->magic, segmentMagic, sizeof(segmentMagic)) != 0 || header->version != segmentVersion
+                || header->fileSize != quint64(size)
+                || header->blockOffsetsOffset + quint64(header->blockCount) * sizeof(quint64) > header->ownerOffsetsOffset
+                || header->ownerOffsetsOffset + (quint64(header->ownerCount) + 1) * sizeof(quint32) > header->ownerPoolOffset
+                || header->ownerPoolOffset > header->fileSize) {
+            return;
+        }
+
+        m_header = header;
+    }
+
+    bool isValid() const { return m_header; }
+    const SegmentHeader &header() const { return *m_header; }
+    bool isSorted() const { return !(m_header->flags & unsortedFlag); }
+    quint32 blockCount() const { return m_header->blockCount; }
+
+    const uchar *blockStart(quint32 block) const
+    {
+        const auto *offsets = reinterpret_cast<const quint64 *>(m_data + m_header->blockOffsetsOffset);
+        return m_data + sizeof(SegmentHeader) + offsets[block];
+    }
+
+    const uchar *blockEnd(quint32 block) const
+    {
+        return block + 1 < m_header->blockCount ? blockStart(block + 1) : m_data + m_header->blockOffsetsOffset;
+    }
+
+    QByteArrayView firstPath(quint32 block) const
+    {
+        const uchar *p = blockStart(block);
+        readVarint(p, blockEnd(block));
+        const quint32 length = readVarint(p, blockEnd(block));
+        return QByteArrayView(p, length);
+    }
+
+    QByteArrayView owner(quint32 id) const
+    {
+        if (id >= m_header->ownerCount) {
+            return QByteArrayView();
+        }
+        const auto *offsets = reinterpret_cast<const quint32 *>(m_data + m_header->ownerOffsetsOffset);
+        const char *pool = reinterpret_cast<const char *>(m_data + m_header->ownerPoolOffset);
+        return QByteArrayView(pool + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+private:
+    const SegmentHeader *m_header;
+    const uchar *m_data;
+};
+
+// Decodes the paths of a segment in order, starting at a given block
+class PathReader
+{
+public:
+    PathReader(const SegmentView &view, quint32 block)
+        : m_view(view)
+        , m_block(block)
+        , m_p(nullptr)
+        , m_end(nullptr)
+        , m_owner(0)
+    {
+        if (m_block < m_view.blockCount()) {
+            m_p = m_view.blockStart(m_block);
+            m_end = m_view.blockEnd(m_block);
+        }
+    }
+
+    bool next()
+    {
+        while (m_p == m_end) {
+            if (++m_block >= m_view.blockCount()) {
+                return false;
+            }
+            m_p = m_view.blockStart(m_block);
+            m_end = m_view.blockEnd(m_block);
+            m_path.clear();
+        }
+
+        const quint32 shared = readVarint(m_p, m_end);
+        const quint32 length = readVarint(m_p, m_end);
+        if (shared > quint32(m_path.size()) || length > quint32(m_end - m_p)) {
+            m_p = m_end = nullptr;
+            m_block = m_view.blockCount();
+            return false;
+        }
+        m_path.truncate(shared);
+        m_path.append(reinterpret_cast<const char *>(m_p), length);
+        m_p += length;
+        m_owner = readVarint(m_p, m_end);
+        return true;
+    }
+
+    const QByteArray &path() const { return m_path; }
+    quint32 owner() const { return m_owner; }
+
+private:
+    const SegmentView &m_view;
+    quint32 m_block;
+    const uchar *m_p;
+    const uchar *m_end;
+    QByteArray m_path;
+    quint32 m_owner;
+};
+
+// Reads the lines of a compressed list, whatever apt compressed it with
+class ListReader
+{
+public:
+    explicit ListReader(const QString &path)
+    {
+        // apt-helper knows every compression apt does, lz4 included
+        m_process.reset(new QProcess);
+        m_process->setProgram(QStringLiteral("/usr/lib/apt/apt-helper"));
+        m_process->setArguments({ QStringLiteral("cat-file"), path });
+        m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        m_process->start(QIODevice::ReadOnly);
+        if (m_process->waitForStarted()) {
+            return;
+        }
+
+        m_process.reset();
+        m_device.reset(new KCompressionDevice(path));
+        if (!m_device->open(QIODevice::ReadOnly)) {
+            m_device.reset();
+        }
+    }
+
+    ~ListReader()
+    {
+        if (m_process) {
+            m_process->kill();
+            m_process->waitForFinished();
+        }
+    }
+
+    bool isOpen() const { return m_process || m_device; }
+
+    bool readLine(QByteArray &line)
+    {
+        if (m_device) {
+            line = m_device->readLine();
+            return !line.isEmpty();
+        }
+        if (!m_process) {
+            return false;
+        }
+
+        while (!m_process->canReadLine()) {
+            if (m_process->state() == QProcess::NotRunning || !m_process->waitForReadyRead(-1)) {
+                if (m_process->canReadLine()) {
+                    break;
+                }
+                // Whatever is left lacks the final newline
+                line = m_process->readAll();
+                return !line.isEmpty();
+            }
+        }
+        line = m_process->readLine();
+        return true;
+    }
+
+    bool succeeded()
+    {
+        if (m_device) {
+            return true;
+        }
+        if (!m_process) {
+            return false;
+        }
+        if (m_process->state() != QProcess::NotRunning) {
+            m_process->waitForFinished(-1);
+        }
+        return m_process->exitStatus() == QProcess::NormalExit && m_process->exitCode() == 0;
+    }
+
+private:
+    std::unique_ptr<QProcess> m_process;
+    std::unique_ptr<QIODevice> m_device;
+};
+
+// Appends the package names in a Contents owner field like "libs/foo,devel/bar"
+void appendOwners(QByteArrayView field, QSet<QByteArray> &seen, QStringList &result)
+{
+    qsizetype start = 0;
+    while (start < field.size()) {
+        qsizetype end = field.indexOf(',', start);
+        if (end < 0) {
+            end = field.size();
+        }
+        QByteArrayView owner = field.sliced(start, end - start);
+        const qsizetype slash = owner.lastIndexOf('/');
+        if (slash >= 0) {
+            owner = owner.sliced(slash + 1);
+        }
+        const QByteArray name = owner.toByteArray();
+        if (!name.isEmpty() && !seen.contains(name)) {
+            seen.insert(name);
+            result.append(QString::fromUtf8(name));
+        }
+        start = end + 1;
+    }
+}
+
+}
+
+ContentsIndex::ContentsIndex(QObject *parent)
+    : QObject(parent)
+    , m_directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % QLatin1String("/contents-index"))
+    , m_watcher(new QFutureWatcher<bool>(this))
+    , m_searchWatcher(new QFutureWatcher<QStringList>(this))
+{
+    connect(m_watcher, &QFutureWatcher<bool>::finished, this, &ContentsIndex::buildFinished);
+    connect(m_searchWatcher, &QFutureWatcher<QStringList>::finished, this, &ContentsIndex::searchDone);
+    open();
+}
+
+ContentsIndex *ContentsIndex::self()
+{
+    static QPointer<ContentsIndex> self;
+    if (!self) {
+        self = new ContentsIndex(QCoreApplication::instance());
+    }
+    return self;
+}
+
+void ContentsIndex::open()
+{
+    close();
+
+    const QFileInfoList files = QDir(m_directory).entryInfoList({ QStringLiteral("*.idx") }, QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        auto *file = new QFile(info.filePath(), this);
+        const uchar *data = nullptr;
+        if (file->open(QIODevice::ReadOnly) && file->size() > 0) {
+            data = file->map(0, file->size());
+        }
+        if (!data || !SegmentView(data, file->size()).isValid()) {
+            delete file;
+            continue;
+        }
+        m_segments.append({ file, data, file->size() });
+    }
+}
+
+void ContentsIndex::close()
+{
+    for (const Segment &segment : std::as_const(m_segments)) {
+        segment.file->unmap(const_cast<uchar *>(segment.data));
+        delete segment.file;
+    }
+    m_segments.clear();
+}
+
+bool ContentsIndex::isAvailable() const
+{
+    return !m_segments.isEmpty();
+}
+
+bool ContentsIndex::isUpdating() const
+{
+    return m_watcher->isRunning();
+}
+
+void ContentsIndex::update()
+{
+    if (m_watcher->isRunning()) {
+        return;
+    }
+
+    m_watcher->setFuture(QtConcurrent::run(&ContentsIndex::build, m_directory,
+                                           QStringLiteral("/var/lib/apt/lists")));
+}
+
+void ContentsIndex::buildFinished()
+{
+    if (!m_watcher->result()) {
+        return;
+    }
+
+    // Searches read the segments that are about to be unmapped. Whoever
+    // searched searches again on updated()
+    m_searchWatcher->cancel();
+    m_searchWatcher->waitForFinished();
+    open();
+    Q_EMIT updated();
+}
+
+QStringList ContentsIndex::packagesProviding(const QString &query, int limit) const
+{
+    QStringList result;
+    QSet<QByteArray> seen;
+    if (!query.startsWith(QLatin1Char('/'))) {
+        return result;
+    }
+
+    // Contents lists have no leading slash, nor a trailing one for directories
+    QByteArray needle = query.toUtf8();
+    needle.remove(0, 1);
+    if (needle.endsWith('/')) {
+        needle.chop(1);
+    }
+    if (needle.isEmpty()) {
+        return result;
+    }
+    const QByteArray directory = needle + '/';
+
+    for (const Segment &segment : m_segments) {
+        const SegmentView view(segment.data, segment.size);
+        if (!view.blockCount()) {
+            continue;
+        }
+
+        // The path, or the paths below it, come right after the last block
+        // starting before it
+        quint32 block = 0;
+        if (view.isSorted()) {
+            quint32 low = 0;
+            quint32 high = view.blockCount();
+            while (low < high) {
+                const quint32 middle = low + (high - low) / 2;
+                if (view.firstPath(middle) <= QByteArrayView(needle)) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            block = low ? low - 1 : 0;
+        }
+
+        QVector<quint32> prefixOwners;
+        bool exact = false;
+        PathReader reader(view, block);
+        while (reader.next()) {
+            const QByteArray &path = reader.path();
+            if (path == needle) {
+                appendOwners(view.owner(reader.owner()), seen, result);
+                exact = true;
+                if (view.isSorted()) {
+                    break;
+                }
+            } else if (path.startsWith(directory)) {
+                if (!prefixOwners.contains(reader.owner())) {
+                    prefixOwners.append(reader.owner());
+                }
+            } else if (view.isSorted() && path > needle && !path.startsWith(needle)) {
+                // Siblings like "foo-bar" sort between "foo" and "foo/", so
+                // only a path not starting with the needle ends the run
+                break;
+            }
+        }
+
+        // Nothing provides the path itself, take everything below it
+        if (!exact) {
+            for (quint32 owner : std::as_const(prefixOwners)) {
+                appendOwners(view.owner(owner), seen, result);
+            }
+        }
+
+        if (result.size() >= limit) {
+            break;
+        }
+    }
+
+    if (result.size() > limit) {
+        result.erase(result.begin() + limit, result.end());
+    }
+    return result;
+}
+
+void ContentsIndex::search(const QString &query, int limit)
+{
+    m_searchWatcher->cancel();
+    m_searchQuery = query;
+    if (query.isEmpty()) {
+        return;
+    }
+
+    m_searchWatcher->setFuture(QtConcurrent::run(&ContentsIndex::searchSegments, m_segments, query.toUtf8(), limit));
+}
+
+void ContentsIndex::searchDone()
+{
+    if (m_searchWatcher->isCanceled() || !m_searchWatcher->future().resultCount()) {
+        return;
+    }
+
+    Q_EMIT searchFinished(m_searchQuery, m_searchWatcher->result());
+}
+
+void ContentsIndex::searchSegments(QPromise<QStringList> &promise, const QVector<Segment> &segments,
+                                   const QByteArray &needle, int limit)
+{
+    QStringList result;
+    QSet<QByteArray> seen;
+    int decoded = 0;
+
+    for (const Segment &segment : segments) {
+        const SegmentView view(segment.data, segment.size);
+        QSet<quint32> matchedOwners;
+        PathReader reader(view, 0);
+        while (reader.next() && result.size() < limit) {
+            if (++decoded % searchCheckInterval == 0 && promise.isCanceled()) {
+                return;
+            }
+            if (!matchedOwners.contains(reader.owner()) && reader.path().contains(needle)) {
+                matchedOwners.insert(reader.owner());
+                appendOwners(view.owner(reader.owner()), seen, result);
+            }
+        }
+
+        if (result.size() >= limit) {
+            break;
+        }
+    }
+
+    if (result.size() > limit) {
+        result.erase(result.begin() + limit, result.end());
+    }
+    promise.addResult(result);
+}
+
+bool ContentsIndex::build(const QString &indexDirectory, const QString &listsDirectory)
+{
+    QDir().mkpath(indexDirectory);
+
+    const QFileInfoList lists = QDir(listsDirectory).entryInfoList({ QStringLiteral("*_Contents-*") }, QDir::Files);
+    QSet<QString> segmentNames;
+    bool changed = false;
+    for (const QFileInfo &list : lists) {
+        // Installer udebs are of no interest to us, and neither are pdiffs
+        if (list.fileName().contains(QLatin1String("Contents-udeb")) || list.fileName().contains(QLatin1String(".diff"))) {
+            continue;
+        }
+
+        const QString segmentName = list.fileName() % QLatin1String(".idx");
+        segmentNames.insert(segmentName);
+        const QString segmentPath = indexDirectory % QLatin1Char('/') % segmentName;
+
+        // Only rebuild segments of lists that changed
+        QFile segment(segmentPath);
+        if (segment.open(QIODevice::ReadOnly)) {
+            SegmentHeader header;
+            if (segment.read(reinterpret_cast<char *>(&header), sizeof(header)) == sizeof(header)
+                    && memcmp(header.magic, segmentMagic, sizeof(segmentMagic)) == 0
+                    && header.version == segmentVersion
+                    && header.listModified == list.lastModified().toMSecsSinceEpoch()
+                    && header.listSize == list.size()) {
+                continue;
+            }
+            segment.close();
+        }
+
+        if (buildSegment(segmentPath, list.filePath())) {
+            changed = true;
+        }
+    }
+
+    // Drop segments of lists that are gone
+    const QStringList segments = QDir(indexDirectory).entryList({ QStringLiteral("*.idx") }, QDir::Files);
+    for (const QString &segment : segments) {
+        if (!segmentNames.contains(segment)) {
+            QFile::remove(indexDirectory % QLatin1Char('/') % segment);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+bool ContentsIndex::buildSegment(const QString &segmentPath, const QString &listPath)
+{
+    const QFileInfo listInfo(listPath);
+    ListReader reader(listPath);
+    if (!reader.isOpen()) {
+        return false;
+    }
+
+    QSaveFile file(segmentPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, segmentMagic, sizeof(segmentMagic));
+    header.version = segmentVersion;
+    header.listModified = listInfo.lastModified().toMSecsSinceEpoch();
+    header.listSize = listInfo.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    QHash<QByteArray, quint32> ownerIds;
+    QVector<quint32> ownerOffsets;
+    QByteArray ownerPool;
+    QVector<quint64> blockOffsets;
+    QByteArray block;
+    quint64 blocksSize = 0;
+    int blockEntries = 0;
+    QByteArray previousPath;
+    QByteArray line;
+
+    auto flushBlock = [&]() {
+        if (!blockEntries) {
+            return;
+        }
+        blockOffsets.append(blocksSize);
+        file.write(block);
+        blocksSize += quint64(block.size());
+        block.clear();
+        blockEntries = 0;
+    };
+
+    while (reader.readLine(line)) {
+        // Lines are the path, whitespace, and a comma-separated list of
+        // section/package owners. Paths may contain spaces themselves
+        const QByteArray trimmed = line.trimmed();
+        qsizetype split = trimmed.size() - 1;
+        while (split >= 0 && trimmed.at(split) != ' ' && trimmed.at(split) != '\t') {
+            --split;
+        }
+        if (split <= 0) {
+            continue;
+        }
+        const QByteArray path = trimmed.left(split).trimmed();
+        const QByteArray owners = trimmed.mid(split + 1);
+        // Old lists start with a "FILE LOCATION" header
+        if (path.isEmpty() || (path == "FILE" && owners == "LOCATION")) {
+            continue;
+        }
+
+        if (path < previousPath) {
+            header.flags |= unsortedFlag;
+        }
+
+        auto owner = ownerIds.constFind(owners);
+        if (owner == ownerIds.constEnd()) {
+            ownerOffsets.append(quint32(ownerPool.size()));
+            ownerPool.append(owners);
+            owner = ownerIds.insert(owners, quint32(ownerIds.size()));
+        }
+
+        if (blockEntries == blockSize) {
+            flushBlock();
+        }
+        qsizetype shared = 0;
+        if (blockEntries) {
+            const qsizetype maximum = std::min(path.size(), previousPath.size());
+            while (shared < maximum && path.at(shared) == previousPath.at(shared)) {
+                ++shared;
+            }
+        }
+        writeVarint(block, quint32(shared));
+        writeVarint(block, quint32(path.size() - shared));
+        block.append(path.constData() + shared, path.size() - shared);
+        writeVarint(block, owner.value());
+        ++blockEntries;
+        ++header.entryCount;
+        previousPath = path;
+    }
+    flushBlock();
+
+    // A list apt could not decompress entirely is no good
+    if (!reader.succeeded()) {
+        file.cancelWriting();
+        return false;
+    }
+
+    ownerOffsets.append(quint32(ownerPool.size()));
+
+    header.blockCount = quint32(blockOffsets.size());
+    header.ownerCount = quint32(ownerIds.size());
+    header.blockOffsetsOffset = sizeof(header) + blocksSize;
+    header.ownerOffsetsOffset = header.blockOffsetsOffset + quint64(blockOffsets.size()) * sizeof(quint64);
+    header.ownerPoolOffset = header.ownerOffsetsOffset + quint64(ownerOffsets.size()) * sizeof(quint32);
+    header.fileSize = header.ownerPoolOffset + quint64(ownerPool.size());
+
+    file.write(reinterpret_cast<const char *>(blockOffsets.constData()), blockOffsets.size() * sizeof(quint64));
+    file.write(reinterpret_cast<const char *>(ownerOffsets.constData()), ownerOffsets.size() * sizeof(quint32));
+    file.write(ownerPool);
+    file.seek(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    return file.commit();
+}
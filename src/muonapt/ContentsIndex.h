@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef CONTENTSINDEX_H
+#define CONTENTSINDEX_H
+
+#include <QtCore/QObject>
+#include <QtCore/QPromise>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QFutureWatcher>
+
+class QFile;
+
+/**
+ * Index of the files in repository packages, built from the Contents indices
+ * that apt-file has apt download into /var/lib/apt/lists.
+ *
+ * Every Contents list gets an index segment of its own in the cache directory,
+ * rebuilt only when the list changes. Segments store the sorted paths
+ * front-coded in small blocks, so they are a fraction of the size of the
+ * uncompressed list, and are memory-mapped for lookups.
+ */
+class ContentsIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static ContentsIndex *self();
+
+    bool isAvailable() const;
+    bool isUpdating() const;
+
+    /**
+     * @returns the names of the packages providing the absolute path @p query,
+     * or of those with files below it if nothing provides the path itself.
+     * Other queries go through search().
+     */
+    QStringList packagesProviding(const QString &query, int limit = 500) const;
+    /**
+     * Looks for the packages with a path containing @p query on a worker
+     * thread, superseding any search still running. searchFinished() follows.
+     */
+    void search(const QString &query, int limit = 500);
+
+public Q_SLOTS:
+    /** Brings the index up to date with the lists in the background */
+    void update();
+
+Q_SIGNALS:
+    void updated();
+    void searchFinished(const QString &query, const QStringList &packages);
+
+private Q_SLOTS:
+    void buildFinished();
+    void searchDone();
+
+private:
+    explicit ContentsIndex(QObject *parent);
+
+    struct Segment
+    {
+        QFile *file;
+        const uchar *data;
+        qint64 size;
+    };
+
+    QString m_directory;
+    QVector<Segment> m_segments;
+    QFutureWatcher<bool> *m_watcher;
+    QFutureWatcher<QStringList> *m_searchWatcher;
+    QString m_searchQuery;
+
+    void open();
+    void close();
+
+    static void searchSegments(QPromise<QStringList> &promise, const QVector<Segment> &segments,
+                               const QByteArray &needle, int limit);
+    static bool build(const QString &indexDirectory, const QString &listsDirectory);
+    static bool buildSegment(const QString &segmentPath, const QString &listPath);
+};
+
+#endif
@@ -0,0 +1,594 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "DependencyGraph.h"
+
+#include <algorithm>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QtConcurrentRun>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+
+// KDE includes
+#include <KFormat>
+#include <KLocalizedString>
+
+// QApt includes
+#include <QApt/Backend>
+#include <QApt/DependencyInfo>
+#include <QApt/Package>
+
+// Milliseconds spent recording packages per event loop iteration
+constexpr int recordSliceTime = 4;
+
+static QString bareName(const QString &name)
+{
+    // Strip multi-arch qualifiers like ":any" and versions of provides
+    int end = name.indexOf(QLatin1Char(' '));
+    end = end < 0 ? name.size() : end;
+    const int colon = name.indexOf(QLatin1Char(':'));
+    if (colon >= 0 && colon < end) {
+        end = colon;
+    }
+    return name.left(end);
+}
+
+static QByteArray dotString(const QString &string)
+{
+    QByteArray quoted = string.toUtf8();
+    quoted.replace('\\', "\\\\");
+    quoted.replace('"', "\\\"");
+    return '"' + quoted + '"';
+}
+
+static QVector<QStringList> dependencyNames(const QList<QApt::DependencyItem> &items)
+{
+    QVector<QStringList> dependencies;
+    dependencies.reserve(items.size());
+    for (const QApt::DependencyItem &item : items) {
+        QStringList alternatives;
+        alternatives.reserve(item.size());
+        for (const QApt::DependencyInfo &info : item) {
+            alternatives.append(info.packageName());
+        }
+        dependencies.append(alternatives);
+    }
+    return dependencies;
+}
+
+DependencyGraph::PackageRecord DependencyGraph::record(QApt::Package *package)
+{
+    PackageRecord record;
+    record.name = nodeName(package);
+    record.architecture = package->architecture();
+    record.foreignArch = package->isForeignArch();
+    record.multiArchForeign = package->multiArchType() == QApt::MultiArchForeign;
+    record.installed = package->isInstalled();
+    record.manual = record.installed && !(package->state() & QApt::Package::IsAuto);
+    record.downloadSize = package->downloadSize();
+    record.installedSize = package->availableInstalledSize();
+    record.provides = package->providesList();
+    record.preDepends = dependencyNames(package->preDepends());
+    record.depends = dependencyNames(package->depends());
+    record.recommends = dependencyNames(package->recommends());
+    return record;
+}
+
+DependencyGraph DependencyGraph::build(const QVector<PackageRecord> &records)
+{
+    DependencyGraph graph;
+
+    // Nodes first, so dependencies can be resolved in one go
+    QHash<QString, QVector<int>> providers;
+    graph.m_names.reserve(records.size());
+    graph.m_flags.reserve(records.size());
+    for (const PackageRecord &record : records) {
+        const int node = graph.m_names.size();
+        // Foreign architecture packages are named after their architecture,
+        // so native ones keep the bare name whatever order the cache has
+        QString name = record.name;
+        if (graph.m_nodes.contains(name)) {
+            name += QLatin1Char(':') + record.architecture;
+        }
+        graph.m_names.append(name);
+        graph.m_nodes.insert(name, node);
+
+        quint8 flags = 0;
+        if (record.installed) {
+            flags |= InstalledFlag;
+        }
+        if (record.manual) {
+            flags |= ManualFlag;
+        }
+        if (record.multiArchForeign) {
+            flags |= MultiArchForeignFlag;
+        }
+        graph.m_flags.append(flags);
+        graph.m_downloadSizes.append(record.downloadSize);
+        graph.m_installedSizes.append(record.installedSize);
+
+        for (const QString &provided : record.provides) {
+            providers[bareName(provided)].append(node);
+        }
+    }
+
+    graph.m_offsets.reserve(records.size() + 1);
+    for (int node = 0; node < records.size(); ++node) {
+        const PackageRecord &record = records.at(node);
+        graph.m_offsets.append(graph.m_targets.size());
+        const int firstEdge = graph.m_targets.size();
+
+        auto addEdge = [&](int target, quint8 kind) {
+            if (target == node) {
+                return;
+            }
+            // Dependency lists rarely go beyond a few dozen entries
+            for (int i = firstEdge; i < graph.m_targets.size(); ++i) {
+                if (graph.m_targets.at(i) == target) {
+                    return;
+                }
+            }
+            graph.m_targets.append(target);
+            graph.m_kinds.append(kind);
+        };
+
+        // Dependencies of a foreign package are on packages of its own
+        // architecture, unless they say otherwise or the package depended on
+        // is Multi-Arch: foreign. Native packages go by the bare name
+        auto resolve = [&](const QString &dependency) {
+            const int colon = dependency.indexOf(QLatin1Char(':'));
+            const QString name = colon < 0 ? dependency : dependency.left(colon);
+            const QString qualifier = colon < 0 ? QString() : dependency.mid(colon + 1);
+            if (qualifier == QLatin1String("any") || qualifier == QLatin1String("native")) {
+                return name;
+            }
+            if (qualifier.isEmpty()) {
+                if (!record.foreignArch) {
+                    return name;
+                }
+                auto native = graph.m_nodes.constFind(name);
+                if (native != graph.m_nodes.constEnd() && (graph.m_flags.at(native.value()) & MultiArchForeignFlag)) {
+                    return name;
+                }
+            }
+
+            const QString qualified = name + QLatin1Char(':') + (qualifier.isEmpty() ? record.architecture : qualifier);
+            return graph.m_nodes.contains(qualified) ? qualified : name;
+        };
+
+        auto addItems = [&](const QVector<QStringList> &items, EdgeKind kind) {
+            for (const QStringList &dependencies : items) {
+                QStringList item;
+                item.reserve(dependencies.size());
+                for (const QString &dependency : dependencies) {
+                    item.append(resolve(dependency));
+                }
+
+                const quint8 alternative = item.size() > 1 ? AlternativeFlag : 0;
+                // apt adds nothing for a dependency that is satisfied already
+                quint8 satisfied = 0;
+                for (const QString &name : item) {
+                    auto target = graph.m_nodes.constFind(name);
+                    if (target != graph.m_nodes.constEnd()) {
+                        if (graph.m_flags.at(target.value()) & InstalledFlag) {
+                            satisfied = SatisfiedFlag;
+                        }
+                        continue;
+                    }
+                    const QVector<int> candidates = providers.value(bareName(name));
+                    for (int provider : candidates) {
+                        if (graph.m_flags.at(provider) & InstalledFlag) {
+                            satisfied = SatisfiedFlag;
+                        }
+                    }
+                }
+
+                // Whether the alternative apt would try first is taken yet
+                bool taken = false;
+                for (const QString &name : item) {
+                    auto target = graph.m_nodes.constFind(name);
+                    if (target != graph.m_nodes.constEnd()) {
+                        addEdge(target.value(), kind | alternative | satisfied
+                                | (alternative && !taken ? PreferredFlag : 0));
+                        taken = true;
+                        continue;
+                    }
+                    // A virtual package, which is as good as any of its providers
+                    const QVector<int> candidates = providers.value(bareName(name));
+                    const quint8 providerAlternative = candidates.size() > 1 ? AlternativeFlag : alternative;
+                    const quint8 recommended = kind == RecommendsEdge ? RecommendedFlag : 0;
+                    for (int provider : candidates) {
+                        addEdge(provider, ProvidesEdge | providerAlternative | recommended | satisfied
+                                | (providerAlternative && !taken ? PreferredFlag : 0));
+                        taken = true;
+                    }
+                }
+            }
+        };
+
+        addItems(record.preDepends, PreDependsEdge);
+        addItems(record.depends, DependsEdge);
+        addItems(record.recommends, RecommendsEdge);
+    }
+    graph.m_offsets.append(graph.m_targets.size());
+
+    // Reverse edges by counting sort over the targets
+    const int nodeCount = graph.m_names.size();
+    graph.m_reverseOffsets.fill(0, nodeCount + 1);
+    for (int target : std::as_const(graph.m_targets)) {
+        ++graph.m_reverseOffsets[target + 1];
+    }
+    for (int node = 0; node < nodeCount; ++node) {
+        graph.m_reverseOffsets[node + 1] += graph.m_reverseOffsets.at(node);
+    }
+    graph.m_sources.resize(graph.m_targets.size());
+    graph.m_reverseKinds.resize(graph.m_targets.size());
+    QVector<int> fill = graph.m_reverseOffsets;
+    for (int node = 0; node < nodeCount; ++node) {
+        for (int edge = graph.m_offsets.at(node); edge < graph.m_offsets.at(node + 1); ++edge) {
+            const int slot = fill[graph.m_targets.at(edge)]++;
+            graph.m_sources[slot] = node;
+            graph.m_reverseKinds[slot] = graph.m_kinds.at(edge);
+        }
+    }
+
+    graph.m_targets.squeeze();
+    graph.m_kinds.squeeze();
+    return graph;
+}
+
+QString DependencyGraph::nodeName(QApt::Package *package)
+{
+    return package->isForeignArch() ? package->name() + QLatin1Char(':') + package->architecture()
+                                    : package->name();
+}
+
+DependencyGraph::EdgeKind DependencyGraph::kindOf(quint8 edge)
+{
+    return EdgeKind(edge & ~(AlternativeFlag | PreferredFlag | RecommendedFlag | SatisfiedFlag));
+}
+
+QString DependencyGraph::edgeKindName(EdgeKind kind)
+{
+    switch (kind) {
+    case DependsEdge:
+        return i18nc("@item dependency type", "Depends");
+    case PreDependsEdge:
+        return i18nc("@item dependency type", "PreDepends");
+    case RecommendsEdge:
+        return i18nc("@item dependency type", "Recommends");
+    case ProvidesEdge:
+        return i18nc("@item dependency type", "Depends on a virtual package provided by");
+    case NoEdge:
+        break;
+    }
+
+    return QString();
+}
+
+bool DependencyGraph::isEmpty() const
+{
+    return m_names.isEmpty();
+}
+
+int DependencyGraph::nodeCount() const
+{
+    return m_names.size();
+}
+
+int DependencyGraph::node(const QString &name) const
+{
+    return m_nodes.value(name, -1);
+}
+
+QString DependencyGraph::name(int node) const
+{
+    return m_names.at(node);
+}
+
+bool DependencyGraph::isInstalled(int node) const
+{
+    return m_flags.at(node) & InstalledFlag;
+}
+
+bool DependencyGraph::isManuallyInstalled(int node) const
+{
+    return m_flags.at(node) & ManualFlag;
+}
+
+QVector<DependencyGraph::Step> DependencyGraph::whyInstalled(int node) const
+{
+    QVector<Step> path;
+    if (node < 0 || !isInstalled(node)) {
+        return path;
+    }
+
+    // Breadth-first up the reverse edges, through installed packages only,
+    // until reaching one that was installed on purpose
+    QVector<int> next(m_names.size(), -1);
+    QVector<quint8> nextKind(m_names.size(), NoEdge);
+    QVector<int> queue;
+    queue.append(node);
+    next[node] = node;
+
+    for (int head = 0; head < queue.size(); ++head) {
+        const int current = queue.at(head);
+        if (isManuallyInstalled(current)) {
+            // Walk back down to the package we started from
+            int step = current;
+            path.append({ step, NoEdge });
+            while (step != node) {
+                const EdgeKind kind = kindOf(nextKind.at(step));
+                step = next.at(step);
+                path.append({ step, kind });
+            }
+            return path;
+        }
+
+        for (int edge = m_reverseOffsets.at(current); edge < m_reverseOffsets.at(current + 1); ++edge) {
+            const int source = m_sources.at(edge);
+            if (next.at(source) < 0 && isInstalled(source)) {
+                next[source] = current;
+                nextKind[source] = m_reverseKinds.at(edge);
+                queue.append(source);
+            }
+        }
+    }
+
+    return path;
+}
+
+QVector<int> DependencyGraph::reverseClosure(int node) const
+{
+    QVector<int> closure;
+    if (node < 0) {
+        return closure;
+    }
+
+    QVector<bool> seen(m_names.size(), false);
+    seen[node] = true;
+    QVector<int> queue;
+    queue.append(node);
+
+    for (int head = 0; head < queue.size(); ++head) {
+        const int current = queue.at(head);
+        for (int edge = m_reverseOffsets.at(current); edge < m_reverseOffsets.at(current + 1); ++edge) {
+            // Recommends do not keep anything from being removed, and neither
+            // does a dependency some other package may satisfy. A virtual
+            // package with a single provider is as good as that provider
+            const quint8 kind = m_reverseKinds.at(edge) & ~SatisfiedFlag;
+            if (kind != DependsEdge && kind != PreDependsEdge && kind != ProvidesEdge) {
+                continue;
+            }
+            const int source = m_sources.at(edge);
+            if (!seen.at(source) && isInstalled(source)) {
+                seen[source] = true;
+                queue.append(source);
+                closure.append(source);
+            }
+        }
+    }
+
+    return closure;
+}
+
+DependencyGraph::InstallEstimate DependencyGraph::installEstimate(int node) const
+{
+    InstallEstimate estimate = { 0, 0, 0 };
+    if (node < 0 || isInstalled(node)) {
+        return estimate;
+    }
+
+    // Everything not installed yet that the package pulls in, taking the
+    // alternative apt would try first. Dependencies that an installed
+    // package satisfies already pull in nothing
+    QVector<bool> seen(m_names.size(), false);
+    seen[node] = true;
+    QVector<int> queue;
+    queue.append(node);
+
+    for (int head = 0; head < queue.size(); ++head) {
+        const int current = queue.at(head);
+        estimate.downloadSize += m_downloadSizes.at(current);
+        estimate.installedSize += m_installedSizes.at(current);
+        ++estimate.newPackages;
+
+        for (int edge = m_offsets.at(current); edge < m_offsets.at(current + 1); ++edge) {
+            const quint8 kind = m_kinds.at(edge);
+            if ((kind & SatisfiedFlag) || ((kind & AlternativeFlag) && !(kind & PreferredFlag))) {
+                continue;
+            }
+            const int target = m_targets.at(edge);
+            if (!seen.at(target) && !isInstalled(target)) {
+                seen[target] = true;
+                queue.append(target);
+            }
+        }
+    }
+
+    return estimate;
+}
+
+QString DependencyGraph::estimateText(const InstallEstimate &estimate)
+{
+    KFormat format;
+    return i18ncp("@info %2 and %3 are sizes",
+                  "Installing adds %1 new package: about %2 to download, %3 on disk",
+                  "Installing adds %1 new packages: about %2 to download, %3 on disk",
+                  estimate.newPackages,
+                  format.formatByteSize(estimate.downloadSize),
+                  format.formatByteSize(estimate.installedSize));
+}
+
+QByteArray DependencyGraph::toGraphviz(const QVector<int> &nodes) const
+{
+    QVector<bool> included(m_names.size(), false);
+    for (int node : nodes) {
+        included[node] = true;
+    }
+
+    QByteArray dot = "digraph dependencies {\n    node [shape=box];\n";
+    for (int node : nodes) {
+        dot += "    " + dotString(m_names.at(node));
+        if (isManuallyInstalled(node)) {
+            dot += " [style=bold]";
+        }
+        dot += ";\n";
+    }
+
+    for (int node : nodes) {
+        for (int edge = m_offsets.at(node); edge < m_offsets.at(node + 1); ++edge) {
+            const int target = m_targets.at(edge);
+            if (!included.at(target)) {
+                continue;
+            }
+            dot += "    " + dotString(m_names.at(node)) + " -> " + dotString(m_names.at(target));
+            switch (kindOf(m_kinds.at(edge))) {
+            case RecommendsEdge:
+                dot += " [style=dashed]";
+                break;
+            case ProvidesEdge:
+                dot += " [style=dotted]";
+                break;
+            }
+            dot += ";\n";
+        }
+    }
+
+    dot += "}\n";
+    return dot;
+}
+
+DependencyGraphStore::DependencyGraphStore(QObject *parent)
+    : QObject(parent)
+    , m_backend(nullptr)
+    , m_recordTimer(new QTimer(this))
+    , m_watcher(new QFutureWatcher<DependencyGraph>(this))
+    , m_loaded(false)
+    , m_outdated(false)
+{
+    m_recordTimer->setInterval(0);
+    connect(m_recordTimer, &QTimer::timeout, this, &DependencyGraphStore::recordMorePackages);
+    connect(m_watcher, &QFutureWatcher<DependencyGraph>::finished, this, &DependencyGraphStore::graphBuilt);
+}
+
+DependencyGraphStore *DependencyGraphStore::self()
+{
+    static QPointer<DependencyGraphStore> self;
+    if (!self) {
+        self = new DependencyGraphStore(QCoreApplication::instance());
+    }
+    return self;
+}
+
+const DependencyGraph &DependencyGraphStore::graph() const
+{
+    return m_graph;
+}
+
+bool DependencyGraphStore::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool DependencyGraphStore::isLoading() const
+{
+    return m_recordTimer->isActive() || m_watcher->isRunning();
+}
+
+DependencyGraph::InstallEstimate DependencyGraphStore::installEstimate(const QString &name)
+{
+    const int node = m_graph.node(name);
+    if (node < 0) {
+        return m_graph.installEstimate(node);
+    }
+
+    auto cached = m_estimates.constFind(node);
+    if (cached != m_estimates.constEnd()) {
+        return cached.value();
+    }
+
+    const DependencyGraph::InstallEstimate estimate = m_graph.installEstimate(node);
+    m_estimates.insert(node, estimate);
+    return estimate;
+}
+
+void DependencyGraphStore::setBackend(QApt::Backend *backend)
+{
+    m_backend = backend;
+    connect(m_backend, SIGNAL(cacheReloadStarted()), this, SLOT(invalidate()));
+}
+
+void DependencyGraphStore::load()
+{
+    if (!m_backend || m_loaded || isLoading()) {
+        return;
+    }
+
+    m_packages = m_backend->availablePackages();
+    m_records.clear();
+    m_records.reserve(m_packages.size());
+    m_recordTimer->start();
+}
+
+void DependencyGraphStore::recordMorePackages()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    while (m_records.size() < m_packages.size() && elapsed.elapsed() < recordSliceTime) {
+        m_records.append(DependencyGraph::record(m_packages.at(m_records.size())));
+    }
+
+    if (m_records.size() < m_packages.size()) {
+        return;
+    }
+
+    m_recordTimer->stop();
+    m_packages.clear();
+    m_outdated = false;
+    m_watcher->setFuture(QtConcurrent::run(&DependencyGraph::build, m_records));
+    m_records.clear();
+}
+
+void DependencyGraphStore::graphBuilt()
+{
+    if (m_outdated) {
+        return;
+    }
+
+    m_graph = m_watcher->result();
+    m_loaded = true;
+    Q_EMIT loaded();
+}
+
+void DependencyGraphStore::invalidate()
+{
+    // Packages still to be recorded are about to go away, and a graph still
+    // being built is one of the old cache
+    m_recordTimer->stop();
+    m_packages.clear();
+    m_records.clear();
+    m_outdated = m_watcher->isRunning();
+    m_graph = DependencyGraph();
+    m_estimates.clear();
+    m_loaded = false;
+}
@@ -0,0 +1,209 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QFutureWatcher>
+
+#include <QApt/Package>
+
+class QTimer;
+
+namespace QApt
+{
+    class Backend;
+}
+
+/**
+ * Snapshot of the package relations of a cache, as a graph in compressed
+ * sparse row form: the edges of node n are m_targets[m_offsets[n]] up to
+ * m_targets[m_offsets[n + 1]]. The reverse edges are stored the same way.
+ *
+ * Nodes are packages. An edge points from a package to one it depends on,
+ * pre-depends on or recommends. Dependencies on virtual packages lead to
+ * every provider of the virtual package.
+ */
+class DependencyGraph
+{
+public:
+    enum EdgeKind : quint8 {
+        NoEdge = 0,
+        DependsEdge,
+        PreDependsEdge,
+        RecommendsEdge,
+        ProvidesEdge
+    };
+
+    // Flag on edges that are one of several alternatives
+    static constexpr quint8 AlternativeFlag = 0x80;
+    // Flag on the alternative apt would try first
+    static constexpr quint8 PreferredFlag = 0x40;
+    // Flag on provides edges that stand for a recommendation
+    static constexpr quint8 RecommendedFlag = 0x20;
+    // Flag on edges of a dependency that some installed package satisfies
+    // already, be it this alternative or another one
+    static constexpr quint8 SatisfiedFlag = 0x10;
+
+    struct Step {
+        int node;
+        EdgeKind kind;  // Kind of the edge from the previous step, NoEdge for the first one
+    };
+
+    struct InstallEstimate {
+        qint64 downloadSize;
+        qint64 installedSize;
+        int newPackages;
+    };
+
+    // What a node is built from. Package data is not thread safe, so this is
+    // read on the GUI thread, and only the records go to the worker
+    struct PackageRecord {
+        QString name;
+        QString architecture;
+        bool foreignArch;
+        // Whether the package satisfies dependencies of any architecture
+        bool multiArchForeign;
+        bool installed;
+        bool manual;
+        qint64 downloadSize;
+        qint64 installedSize;
+        QStringList provides;
+        // Every dependency as the names of its alternatives, with their
+        // architecture qualifiers
+        QVector<QStringList> preDepends;
+        QVector<QStringList> depends;
+        QVector<QStringList> recommends;
+    };
+
+    static PackageRecord record(QApt::Package *package);
+    /** Builds the graph of all packages. This is meant to run off the GUI thread. */
+    static DependencyGraph build(const QVector<PackageRecord> &records);
+    static QString edgeKindName(EdgeKind kind);
+    /** @returns the name of the node of @p package */
+    static QString nodeName(QApt::Package *package);
+
+    bool isEmpty() const;
+    int nodeCount() const;
+    /**
+     * @returns the node of package @p name, or -1. Packages of foreign
+     * architectures are named "name:arch", native ones just "name".
+     */
+    int node(const QString &name) const;
+    QString name(int node) const;
+    bool isInstalled(int node) const;
+    bool isManuallyInstalled(int node) const;
+
+    /**
+     * @returns the shortest chain of installed packages from a manually
+     * installed one down to @p node, or nothing if @p node is not installed or
+     * is only kept around by nothing
+     */
+    QVector<Step> whyInstalled(int node) const;
+    /**
+     * @returns the installed packages that depend on @p node, directly or not,
+     * through dependencies without alternatives. These would be removed along
+     * with it.
+     */
+    QVector<int> reverseClosure(int node) const;
+    /**
+     * @returns what installing @p node would add, going by the packages it
+     * pulls in that are not installed yet. This ignores upgrades and
+     * conflicts, so it is only an estimate of what the resolver ends up with.
+     */
+    InstallEstimate installEstimate(int node) const;
+    static QString estimateText(const InstallEstimate &estimate);
+    /** @returns the subgraph of @p nodes in Graphviz' dot language */
+    QByteArray toGraphviz(const QVector<int> &nodes) const;
+
+private:
+    static EdgeKind kindOf(quint8 edge);
+
+    enum NodeFlag : quint8 {
+        InstalledFlag = 0x1,
+        ManualFlag = 0x2,
+        MultiArchForeignFlag = 0x4
+    };
+
+    QStringList m_names;
+    QHash<QString, int> m_nodes;
+    QVector<quint8> m_flags;
+    // Sizes of the candidate versions
+    QVector<qint64> m_downloadSizes;
+    QVector<qint64> m_installedSizes;
+
+    QVector<int> m_offsets;
+    QVector<int> m_targets;
+    QVector<quint8> m_kinds;
+
+    QVector<int> m_reverseOffsets;
+    QVector<int> m_sources;
+    QVector<quint8> m_reverseKinds;
+};
+
+/**
+ * Application-wide owner of the dependency graph of the current cache. The
+ * graph is built on first use and dropped when the cache reloads.
+ */
+class DependencyGraphStore : public QObject
+{
+    Q_OBJECT
+public:
+    static DependencyGraphStore *self();
+
+    const DependencyGraph &graph() const;
+    bool isLoaded() const;
+    bool isLoading() const;
+    /** @returns the install estimate of package @p name, which must be in the loaded graph */
+    DependencyGraph::InstallEstimate installEstimate(const QString &name);
+
+public Q_SLOTS:
+    void setBackend(QApt::Backend *backend);
+    /** Builds the graph in the background, unless it is built or being built */
+    void load();
+
+Q_SIGNALS:
+    void loaded();
+
+private Q_SLOTS:
+    void recordMorePackages();
+    void graphBuilt();
+    void invalidate();
+
+private:
+    explicit DependencyGraphStore(QObject *parent);
+
+    QApt::Backend *m_backend;
+    DependencyGraph m_graph;
+    // Packages being recorded for the next build, a few milliseconds at a time
+    QApt::PackageList m_packages;
+    QVector<DependencyGraph::PackageRecord> m_records;
+    QTimer *m_recordTimer;
+    // Estimates are asked for on every package shown, so keep them
+    QHash<int, DependencyGraph::InstallEstimate> m_estimates;
+    QFutureWatcher<DependencyGraph> *m_watcher;
+    bool m_loaded;
+    // Set when the cache reloaded while the graph was being built
+    bool m_outdated;
+};
+
+#endif
@@ -0,0 +1,421 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "FileIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QtConcurrentRun>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QStringBuilder>
+
+// Bumped whenever the layout below changes
+constexpr quint32 indexVersion = 1;
+constexpr char indexMagic[8] = { 'M', 'U', 'O', 'N', 'F', 'I', 'D', 'X' };
+// Paths a search goes through between checks whether it was canceled
+constexpr int searchCheckInterval = 4096;
+
+/*
+ * The index file is laid out as a header, the package table, the entry table
+ * sorted by path and finally the string pool. Offsets of strings are relative
+ * to the start of the pool. Everything is in host byte order, the file never
+ * leaves the machine it was built on.
+ */
+struct IndexHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 packageCount;
+    quint32 entryCount;
+    quint32 reserved;
+    quint64 stringPoolSize;
+};
+
+struct IndexPackage
+{
+    quint32 nameOffset;
+    quint32 nameLength;
+    qint64 listModified;  // Modification time of the .list file, in msecs since the epoch
+};
+
+struct IndexEntry
+{
+    quint32 pathOffset;
+    quint32 pathLength;
+    quint32 package;
+};
+
+namespace {
+
+// Read-only view of a mapped index
+class IndexView
+{
+public:
+    IndexView(const uchar *data, qint64 size)
+        : m_header(nullptr)
+    {
+        if (!data || size < qint64(sizeof(IndexHeader))) {
+            return;
+        }
+
+        const auto *header = reinterpret_cast<const IndexHeader *>(data);
+        if (memcmp(header->magic, indexMagic, sizeof(indexMagic)) != 0 || header->version != indexVersion) {
+            return;
+        }
+
+        const qint64 expectedSize = qint64(sizeof(IndexHeader)) + qint64(header->packageCount) * sizeof(IndexPackage)
+                + qint64(header->entryCount) * sizeof(IndexEntry) + qint64(header->stringPoolSize);
+        if (expectedSize != size) {
+            return;
+        }
+
+        m_header = header;
+        m_packages = reinterpret_cast<const IndexPackage *>(data + sizeof(IndexHeader));
+        m_entries = reinterpret_cast<const IndexEntry *>(m_packages + header->packageCount);
+        m_strings = reinterpret_cast<const char *>(m_entries + header->entryCount);
+    }
+
+    bool isValid() const { return m_header; }
+    quint32 packageCount() const { return m_header->packageCount; }
+    quint32 entryCount() const { return m_header->entryCount; }
+    const IndexPackage &package(quint32 i) const { return m_packages[i]; }
+    const IndexEntry &entry(quint32 i) const { return m_entries[i]; }
+
+    QByteArray packageName(quint32 i) const
+    {
+        return QByteArray(m_strings + m_packages[i].nameOffset, m_packages[i].nameLength);
+    }
+
+    QByteArrayView path(const IndexEntry &entry) const
+    {
+        return QByteArrayView(m_strings + entry.pathOffset, entry.pathLength);
+    }
+
+    const IndexEntry *begin() const { return m_entries; }
+    const IndexEntry *end() const { return m_entries + m_header->entryCount; }
+
+private:
+    const IndexHeader *m_header;
+    const IndexPackage *m_packages;
+    const IndexEntry *m_entries;
+    const char *m_strings;
+};
+
+}
+
+FileIndex::FileIndex(QObject *parent)
+    : QObject(parent)
+    , m_indexPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % QLatin1String("/file-index"))
+    , m_data(nullptr)
+    , m_size(0)
+    , m_watcher(new QFutureWatcher<bool>(this))
+    , m_searchWatcher(new QFutureWatcher<QStringList>(this))
+{
+    connect(m_watcher, &QFutureWatcher<bool>::finished, this, &FileIndex::buildFinished);
+    connect(m_searchWatcher, &QFutureWatcher<QStringList>::finished, this, &FileIndex::searchDone);
+    open();
+}
+
+FileIndex *FileIndex::self()
+{
+    static QPointer<FileIndex> self;
+    if (!self) {
+        self = new FileIndex(QCoreApplication::instance());
+    }
+    return self;
+}
+
+void FileIndex::open()
+{
+    close();
+
+    m_file.setFileName(m_indexPath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    m_size = m_file.size();
+    m_data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+    if (!m_data || !IndexView(m_data, m_size).isValid()) {
+        close();
+    }
+}
+
+void FileIndex::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+    m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool FileIndex::isAvailable() const
+{
+    return m_data;
+}
+
+bool FileIndex::isUpdating() const
+{
+    return m_watcher->isRunning();
+}
+
+void FileIndex::update()
+{
+    if (m_watcher->isRunning()) {
+        return;
+    }
+
+    m_watcher->setFuture(QtConcurrent::run(&FileIndex::build, m_indexPath,
+                                           QStringLiteral("/var/lib/dpkg/info")));
+}
+
+void FileIndex::buildFinished()
+{
+    if (!m_watcher->result()) {
+        return;
+    }
+
+    // The new index replaced the file, the old mapping still points at the
+    // previous one. Searches read that mapping, whoever searched searches
+    // again on updated()
+    m_searchWatcher->cancel();
+    m_searchWatcher->waitForFinished();
+    open();
+    Q_EMIT updated();
+}
+
+QStringList FileIndex::packagesOwning(const QString &query, int limit) const
+{
+    QStringList result;
+    const IndexView view(m_data, m_size);
+    if (!view.isValid() || !query.startsWith(QLatin1Char('/'))) {
+        return result;
+    }
+
+    const QByteArray needle = query.toUtf8();
+    QSet<quint32> owners;
+    auto addOwner = [&](const IndexEntry &entry) {
+        if (!owners.contains(entry.package)) {
+            owners.insert(entry.package);
+            result.append(QString::fromUtf8(view.packageName(entry.package)));
+        }
+        return result.size() < limit;
+    };
+
+    QByteArrayView path(needle);
+    // dpkg does not list directories with a trailing slash
+    if (path.size() > 1 && path.endsWith('/')) {
+        path.chop(1);
+    }
+
+    auto lowerBound = [&view](QByteArrayView value) {
+        return std::lower_bound(view.begin(), view.end(), value, [&view](const IndexEntry &entry, QByteArrayView value) {
+            return view.path(entry) < value;
+        });
+    };
+    for (auto it = lowerBound(path); it != view.end() && view.path(*it) == path; ++it) {
+        if (!addOwner(*it)) {
+            return result;
+        }
+    }
+    if (!result.isEmpty()) {
+        return result;
+    }
+
+    // Nothing owns the path itself, try everything below it. Siblings like
+    // "foo-bar" sort between "foo" and "foo/", so look for "foo/" itself
+    const QByteArray directory = path.endsWith('/') ? path.toByteArray() : path.toByteArray() + '/';
+    for (auto it = lowerBound(directory); it != view.end() && view.path(*it).startsWith(directory); ++it) {
+        if (!addOwner(*it)) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+void FileIndex::search(const QString &query, int limit)
+{
+    m_searchWatcher->cancel();
+    m_searchQuery = query;
+    if (query.isEmpty() || !m_data) {
+        return;
+    }
+
+    m_searchWatcher->setFuture(QtConcurrent::run(&FileIndex::searchPaths, m_data, m_size, query.toUtf8(), limit));
+}
+
+void FileIndex::searchDone()
+{
+    if (m_searchWatcher->isCanceled() || !m_searchWatcher->future().resultCount()) {
+        return;
+    }
+
+    Q_EMIT searchFinished(m_searchQuery, m_searchWatcher->result());
+}
+
+void FileIndex::searchPaths(QPromise<QStringList> &promise, const uchar *data, qint64 size,
+                            const QByteArray &needle, int limit)
+{
+    QStringList result;
+    const IndexView view(data, size);
+    if (!view.isValid()) {
+        promise.addResult(result);
+        return;
+    }
+
+    QSet<quint32> owners;
+    int checked = 0;
+    for (auto it = view.begin(); it != view.end() && result.size() < limit; ++it) {
+        if (++checked % searchCheckInterval == 0 && promise.isCanceled()) {
+            return;
+        }
+        if (!owners.contains(it->package) && view.path(*it).contains(needle)) {
+            owners.insert(it->package);
+            result.append(QString::fromUtf8(view.packageName(it->package)));
+        }
+    }
+
+    promise.addResult(result);
+}
+
+bool FileIndex::build(const QString &indexPath, const QString &infoDirectory)
+{
+    const QFileInfoList lists = QDir(infoDirectory).entryInfoList({ QStringLiteral("*.list") }, QDir::Files, QDir::Name);
+
+    // Map the previous index, if any, to reuse the paths of unchanged lists
+    QFile oldFile(indexPath);
+    const uchar *oldData = nullptr;
+    qint64 oldSize = 0;
+    if (oldFile.open(QIODevice::ReadOnly)) {
+        oldSize = oldFile.size();
+        oldData = oldSize > 0 ? oldFile.map(0, oldSize) : nullptr;
+    }
+    const IndexView oldView(oldData, oldSize);
+
+    QHash<QByteArray, quint32> oldPackages;
+    QVector<QVector<quint32>> oldEntriesByPackage;
+    if (oldView.isValid()) {
+        oldEntriesByPackage.resize(oldView.packageCount());
+        for (quint32 i = 0; i < oldView.packageCount(); ++i) {
+            oldPackages.insert(oldView.packageName(i), i);
+        }
+    }
+
+    QByteArray strings;
+    QVector<IndexPackage> packages;
+    QVector<IndexEntry> entries;
+    packages.reserve(lists.size());
+
+    auto addString = [&strings](QByteArrayView string) {
+        const quint32 offset = quint32(strings.size());
+        strings.append(string.data(), string.size());
+        return offset;
+    };
+
+    bool changed = !oldView.isValid() || quint32(lists.size()) != oldView.packageCount();
+    bool bucketed = false;
+    for (const QFileInfo &info : lists) {
+        const QByteArray name = QFile::encodeName(info.completeBaseName());
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        const quint32 package = quint32(packages.size());
+        packages.append({ addString(name), quint32(name.size()), modified });
+
+        auto old = oldPackages.constFind(name);
+        if (old != oldPackages.constEnd() && oldView.package(old.value()).listModified == modified) {
+            // Only group the old entries by package once it turns out to be needed
+            if (!bucketed) {
+                for (quint32 i = 0; i < oldView.entryCount(); ++i) {
+                    oldEntriesByPackage[oldView.entry(i).package].append(i);
+                }
+                bucketed = true;
+            }
+            for (quint32 i : std::as_const(oldEntriesByPackage.at(old.value()))) {
+                const QByteArrayView path = oldView.path(oldView.entry(i));
+                entries.append({ addString(path), quint32(path.size()), package });
+            }
+            continue;
+        }
+
+        changed = true;
+        QFile list(info.filePath());
+        if (!list.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray contents = list.readAll();
+        qsizetype start = 0;
+        while (start < contents.size()) {
+            qsizetype end = contents.indexOf('\n', start);
+            if (end < 0) {
+                end = contents.size();
+            }
+            const QByteArrayView line(contents.constData() + start, end - start);
+            start = end + 1;
+            // Every list starts with "/.", which is of no use to anybody
+            if (line.size() < 2 || line.front() != '/') {
+                continue;
+            }
+            entries.append({ addString(line), quint32(line.size()), package });
+        }
+    }
+
+    if (oldData) {
+        oldFile.unmap(const_cast<uchar *>(oldData));
+    }
+    oldFile.close();
+
+    if (!changed) {
+        return false;
+    }
+
+    const char *pool = strings.constData();
+    std::sort(entries.begin(), entries.end(), [pool](const IndexEntry &a, const IndexEntry &b) {
+        return QByteArrayView(pool + a.pathOffset, a.pathLength) < QByteArrayView(pool + b.pathOffset, b.pathLength);
+    });
+
+    IndexHeader header;
+    memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.version = indexVersion;
+    header.packageCount = quint32(packages.size());
+    header.entryCount = quint32(entries.size());
+    header.reserved = 0;
+    header.stringPoolSize = quint64(strings.size());
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(packages.constData()), packages.size() * sizeof(IndexPackage));
+    file.write(reinterpret_cast<const char *>(entries.constData()), entries.size() * sizeof(IndexEntry));
+    file.write(strings);
+
+    return file.commit();
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <QtCore/QFile>
+#include <QtCore/QObject>
+#include <QtCore/QPromise>
+#include <QtCore/QStringList>
+#include <QFutureWatcher>
+
+/**
+ * Reverse index from installed file paths to the packages owning them, built
+ * from the dpkg file lists in /var/lib/dpkg/info.
+ *
+ * The index lives in a file in the cache directory: a table of packages, an
+ * array of (path, package) entries sorted by path and a pool of path bytes.
+ * It is memory-mapped for lookups, so opening it costs nothing and exact
+ * lookups are a binary search.
+ *
+ * Rebuilding only reads the file lists that changed since the last build,
+ * going by their modification times.
+ */
+class FileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static FileIndex *self();
+
+    bool isAvailable() const;
+    bool isUpdating() const;
+
+    /**
+     * @returns the packages owning the absolute path @p query, or those with
+     * files below it if nothing owns the path itself. Other queries go
+     * through search().
+     */
+    QStringList packagesOwning(const QString &query, int limit = 500) const;
+    /**
+     * Looks for the packages with a path containing @p query on a worker
+     * thread, superseding any search still running. searchFinished() follows.
+     */
+    void search(const QString &query, int limit = 500);
+
+public Q_SLOTS:
+    /** Brings the index up to date in the background */
+    void update();
+
+Q_SIGNALS:
+    void updated();
+    void searchFinished(const QString &query, const QStringList &packages);
+
+private Q_SLOTS:
+    void buildFinished();
+    void searchDone();
+
+private:
+    explicit FileIndex(QObject *parent);
+
+    QString m_indexPath;
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QFutureWatcher<bool> *m_watcher;
+    QFutureWatcher<QStringList> *m_searchWatcher;
+    QString m_searchQuery;
+
+    void open();
+    void close();
+
+    static void searchPaths(QPromise<QStringList> &promise, const uchar *data, qint64 size,
+                            const QByteArray &needle, int limit);
+    static bool build(const QString &indexPath, const QString &infoDirectory);
+};
+
+#endif
@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryDelegate.h"
+
+#include <QApt/Package>
+
+#include "HistoryModel.h"
+
+HistoryDelegate::HistoryDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+    , m_colorScheme(QPalette::Current, KColorScheme::Window)
+{
+}
+
+void HistoryDelegate::updateColorScheme()
+{
+    m_colorScheme = KColorScheme(QPalette::Current, KColorScheme::Window);
+}
+
+void HistoryDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    const QVariant action = index.data(HistoryModel::HistoryActionRole);
+    if (!action.isValid()) {
+        return;
+    }
+
+    QColor color;
+    switch (action.toInt()) {
+        case QApt::Package::ToInstall:
+            color = m_colorScheme.foreground(KColorScheme::PositiveText).color();
+            break;
+        case QApt::Package::ToUpgrade:
+            color = m_colorScheme.decoration(KColorScheme::FocusColor).color();
+            break;
+        case QApt::Package::ToDowngrade:
+            color = m_colorScheme.foreground(KColorScheme::NeutralText).color();
+            break;
+        case QApt::Package::ToRemove:
+        case QApt::Package::ToPurge:
+            color = m_colorScheme.foreground(KColorScheme::NegativeText).color();
+            break;
+        case QApt::Package::ToReInstall:
+            color = m_colorScheme.foreground(KColorScheme::VisitedText).color();
+            break;
+        default:
+            color = m_colorScheme.foreground(KColorScheme::NormalText).color();
+            break;
+    }
+    option->palette.setColor(QPalette::Text, color);
+}
@@ -0,0 +1,269 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryLogReader.h"
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include <QtConcurrentMap>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <KCompressionDevice>
+
+#include <QApt/Package>
+
+static QStringList parsePackageList(const QString &list)
+{
+    // Entries look like "foo:amd64 (1.0, automatic)", and versions may contain
+    // commas of their own, so only split outside of parentheses
+    QStringList packages;
+    int depth = 0;
+    int nameStart = 0;
+    int nameEnd = -1;
+
+    for (int i = 0; i <= list.size(); ++i) {
+        const QChar c = i < list.size() ? list.at(i) : QLatin1Char(',');
+        if (c == QLatin1Char('(')) {
+            if (depth++ == 0 && nameEnd == -1) {
+                nameEnd = i;
+            }
+        } else if (c == QLatin1Char(')')) {
+            depth = qMax(0, depth - 1);
+        } else if (c == QLatin1Char(',') && depth == 0) {
+            const QString name = list.mid(nameStart, (nameEnd == -1 ? i : nameEnd) - nameStart).trimmed();
+            if (!name.isEmpty()) {
+                packages.append(name);
+            }
+            nameStart = i + 1;
+            nameEnd = -1;
+        }
+    }
+
+    return packages;
+}
+
+static int actionForField(const QByteArray &field)
+{
+    if (field == "Install") {
+        return QApt::Package::ToInstall;
+    } else if (field == "Upgrade") {
+        return QApt::Package::ToUpgrade;
+    } else if (field == "Downgrade") {
+        return QApt::Package::ToDowngrade;
+    } else if (field == "Remove") {
+        return QApt::Package::ToRemove;
+    } else if (field == "Purge") {
+        return QApt::Package::ToPurge;
+    } else if (field == "Reinstall") {
+        return QApt::Package::ToReInstall;
+    }
+
+    return 0;
+}
+
+HistoryLogReader::HistoryLogReader(const QString &directory)
+    : m_directory(directory)
+    , m_liveOffset(0)
+    , m_liveIdentity({ 0, 0, QByteArray() })
+{
+}
+
+QString HistoryLogReader::livePath() const
+{
+    return m_directory + QLatin1String("/history.log");
+}
+
+QStringList HistoryLogReader::logFiles() const
+{
+    // Rotated logs are history.log.1, history.log.2.gz and so on, where a
+    // higher number means an older log
+    QDir dir(m_directory);
+    QStringList names = dir.entryList({ QStringLiteral("history.log.*") }, QDir::Files);
+    std::sort(names.begin(), names.end(), [](const QString &a, const QString &b) {
+        return a.section(QLatin1Char('.'), 2, 2).toInt() > b.section(QLatin1Char('.'), 2, 2).toInt();
+    });
+
+    QStringList paths;
+    for (const QString &name : std::as_const(names)) {
+        paths.append(dir.filePath(name));
+    }
+    return paths;
+}
+
+HistoryTable HistoryLogReader::readAll()
+{
+    // Rotated logs never change, so hand them to the thread pool and parse the
+    // live one here in the meantime
+    QFuture<QVector<HistoryLogEntry>> rotated = QtConcurrent::mapped(logFiles(), &HistoryLogReader::readFile);
+
+    QVector<HistoryLogEntry> liveEntries;
+    m_liveOffset = 0;
+    m_liveIdentity = { 0, 0, QByteArray() };
+    QFile liveLog(livePath());
+    if (liveLog.open(QIODevice::ReadOnly)) {
+        m_liveIdentity = identify(&liveLog);
+        liveEntries = parse(&liveLog, 0, &m_liveOffset, false);
+    }
+
+    // Results come back in file order, oldest first
+    QVector<HistoryLogEntry> entries;
+    const QList<QVector<HistoryLogEntry>> results = rotated.results();
+    for (const QVector<HistoryLogEntry> &fileEntries : results) {
+        entries += fileEntries;
+    }
+    entries += liveEntries;
+
+    // Each file is already in order, this only fixes up overlaps between them
+    std::stable_sort(entries.begin(), entries.end(), [](const HistoryLogEntry &a, const HistoryLogEntry &b) {
+        return a.startDate < b.startDate;
+    });
+
+    HistoryTable table;
+    appendEntries(&table, entries);
+    table.squeeze();
+    return table;
+}
+
+bool HistoryLogReader::readTail(HistoryTable *table)
+{
+    QFile liveLog(livePath());
+    if (!liveLog.open(QIODevice::ReadOnly) || liveLog.size() < m_liveOffset) {
+        return false;
+    }
+
+    // A rotated log may well have grown past the old offset already, which
+    // would then point into the middle of some transaction
+    if (!(identify(&liveLog) == m_liveIdentity)) {
+        return false;
+    }
+
+    if (liveLog.size() == m_liveOffset) {
+        return true;
+    }
+
+    if (!liveLog.seek(m_liveOffset)) {
+        return false;
+    }
+
+    appendEntries(table, parse(&liveLog, m_liveOffset, &m_liveOffset, false));
+    return true;
+}
+
+HistoryLogReader::LiveIdentity HistoryLogReader::identify(QFile *file)
+{
+    LiveIdentity identity = { 0, 0, QByteArray() };
+    struct stat info;
+    if (fstat(file->handle(), &info) == 0) {
+        identity.device = quint64(info.st_dev);
+        identity.inode = quint64(info.st_ino);
+    }
+
+    // logrotate's copytruncate keeps the inode, but not the first transaction.
+    // Logs start with an empty line, so that one says nothing
+    while (!file->atEnd() && identity.firstLine.trimmed().isEmpty()) {
+        identity.firstLine = file->readLine();
+    }
+    file->seek(0);
+    return identity;
+}
+
+QVector<HistoryLogEntry> HistoryLogReader::readFile(const QString &path)
+{
+    // Picks gzip, bzip2 or xz from the file name and falls back to plain files
+    KCompressionDevice device(path);
+    if (!device.open(QIODevice::ReadOnly)) {
+        return QVector<HistoryLogEntry>();
+    }
+
+    // Rotated logs are final, so an unfinished transaction stays unfinished
+    qint64 endOffset = 0;
+    return parse(&device, 0, &endOffset, true);
+}
+
+QVector<HistoryLogEntry> HistoryLogReader::parse(QIODevice *device, qint64 startOffset, qint64 *endOffset,
+                                                 bool keepUnfinished)
+{
+    QVector<HistoryLogEntry> entries;
+    HistoryLogEntry current;
+    bool inEntry = false;
+    qint64 offset = startOffset;
+
+    while (!device->atEnd()) {
+        const QByteArray line = device->readLine();
+        if (line.isEmpty()) {
+            break;
+        }
+        const qint64 lineStart = offset;
+        offset += line.size();
+
+        const int colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+
+        const QByteArray field = line.left(colon);
+        if (field == "Start-Date") {
+            if (inEntry) {
+                // apt never got to write the End-Date, keep what we have
+                entries.append(current);
+                *endOffset = lineStart;
+            }
+            current = HistoryLogEntry();
+            current.startDate = QDateTime::fromString(QString::fromUtf8(line.mid(colon + 1)).simplified(),
+                                                      QStringLiteral("yyyy-MM-dd hh:mm:ss"));
+            inEntry = true;
+        } else if (field == "End-Date") {
+            if (inEntry) {
+                entries.append(current);
+                *endOffset = offset;
+                inEntry = false;
+            }
+        } else if (inEntry) {
+            const int action = actionForField(field);
+            if (action) {
+                current.changes.append({ action, parsePackageList(QString::fromUtf8(line.mid(colon + 1))) });
+            }
+        }
+    }
+
+    // In the live log, a transaction without End-Date at the end of the file
+    // is most likely still running. It is picked up by the next readTail()
+    if (inEntry && keepUnfinished) {
+        entries.append(current);
+        *endOffset = offset;
+    }
+
+    return entries;
+}
+
+void HistoryLogReader::appendEntries(HistoryTable *table, const QVector<HistoryLogEntry> &entries)
+{
+    for (const HistoryLogEntry &entry : entries) {
+        if (!entry.startDate.isValid()) {
+            continue;
+        }
+
+        for (const auto &change : entry.changes) {
+            table->appendTransaction(entry.startDate, change.first, change.second);
+        }
+    }
+}
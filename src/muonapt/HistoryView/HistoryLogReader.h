@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef HISTORYLOGREADER_H
+#define HISTORYLOGREADER_H
+
+#include <QtCore/QDateTime>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include "HistoryTable.h"
+
+class QFile;
+class QIODevice;
+
+/**
+ * One transaction of the apt history log
+ */
+struct HistoryLogEntry
+{
+    QDateTime startDate;
+    // Past action as a QApt::Package::State flag, with the packages it affected
+    QVector<QPair<int, QStringList>> changes;
+};
+
+/**
+ * Reads the apt history logs straight from the log directory.
+ *
+ * The live history.log and all of its rotated, possibly gzipped, siblings are
+ * parsed in parallel, one file per worker. The reader remembers how far into
+ * the live log it got, so that transactions logged later can be appended
+ * without reading everything again.
+ */
+class HistoryLogReader
+{
+public:
+    explicit HistoryLogReader(const QString &directory = QStringLiteral("/var/log/apt"));
+
+    QString livePath() const;
+
+    /** Parses all history logs into a new table. This is meant to run off the GUI thread. */
+    HistoryTable readAll();
+
+    /**
+     * Appends the transactions completed since the last read to @p table.
+     *
+     * @returns false if the live log has been rotated or truncated in the
+     * meantime, in which case readAll() has to be used instead
+     */
+    bool readTail(HistoryTable *table);
+
+private:
+    QString m_directory;
+    // Byte offset just past the last complete transaction of the live log
+    qint64 m_liveOffset;
+    // What m_liveOffset is an offset into. A log rotated in the meantime is
+    // another file, or at least starts differently if it was truncated
+    struct LiveIdentity {
+        quint64 device;
+        quint64 inode;
+        QByteArray firstLine;
+
+        bool operator==(const LiveIdentity &other) const
+        {
+            return device == other.device && inode == other.inode && firstLine == other.firstLine;
+        }
+    };
+    LiveIdentity m_liveIdentity;
+
+    QStringList logFiles() const;
+
+    static LiveIdentity identify(QFile *file);
+
+    static QVector<HistoryLogEntry> readFile(const QString &path);
+    static QVector<HistoryLogEntry> parse(QIODevice *device, qint64 startOffset, qint64 *endOffset,
+                                          bool keepUnfinished);
+    static void appendEntries(HistoryTable *table, const QVector<HistoryLogEntry> &entries);
+};
+
+#endif
@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryModel.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QLocale>
+
+#include <KLocalizedString>
+
+#include <QApt/Package>
+
+// Number of child rows materialized per fetchMore() call
+constexpr int fetchBatchSize = 256;
+
+HistoryModel::HistoryModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+QString HistoryModel::actionName(int action)
+{
+    switch (action) {
+    case QApt::Package::ToInstall:
+        return i18nc("@info:status describes a past-tense action", "Installed");
+    case QApt::Package::ToUpgrade:
+        return i18nc("@info:status describes a past-tense action", "Upgraded");
+    case QApt::Package::ToDowngrade:
+        return i18nc("@status describes a past-tense action", "Downgraded");
+    case QApt::Package::ToRemove:
+        return i18nc("@status describes a past-tense action", "Removed");
+    case QApt::Package::ToPurge:
+        return i18nc("@status describes a past-tense action", "Purged");
+    case QApt::Package::ToReInstall:
+        return i18nc("@status describes a past-tense action", "Reinstalled");
+    }
+
+    return QString();
+}
+
+QIcon HistoryModel::actionIcon(int action)
+{
+    switch (action) {
+    case QApt::Package::ToInstall:
+        return QIcon::fromTheme(QStringLiteral("download"));
+    case QApt::Package::ToUpgrade:
+        return QIcon::fromTheme(QStringLiteral("system-software-update"));
+    case QApt::Package::ToDowngrade:
+        return QIcon::fromTheme(QStringLiteral("go-down"));
+    case QApt::Package::ToRemove:
+        return QIcon::fromTheme(QStringLiteral("edit-delete"));
+    case QApt::Package::ToPurge:
+        return QIcon::fromTheme(QStringLiteral("edit-delete-shred"));
+    case QApt::Package::ToReInstall:
+        return QIcon::fromTheme(QStringLiteral("view-refresh"));
+    }
+
+    return QIcon();
+}
+
+void HistoryModel::setTable(const HistoryTable &table)
+{
+    beginResetModel();
+    m_table = table;
+    m_fetchedCounts.fill(0, m_table.dateGroups().size());
+    m_eventCounts.clear();
+    for (const HistoryDateGroup &dateGroup : m_table.dateGroups()) {
+        m_eventCounts.append(dateGroup.eventCount);
+    }
+    endResetModel();
+}
+
+void HistoryModel::appendFromTable(const HistoryTable &table)
+{
+    const int oldGroupCount = m_eventCounts.size();
+    const int newGroupCount = table.dateGroups().size();
+    if (!oldGroupCount) {
+        setTable(table);
+        return;
+    }
+
+    // New events may continue the newest day we already have
+    const int lastGroup = oldGroupCount - 1;
+    const int addedToLast = table.dateGroups().at(lastGroup).eventCount - m_eventCounts.at(lastGroup);
+
+    // Views only see as many days and events of the table as the event
+    // counts hold, so the new ones show up as their rows are announced
+    m_table = table;
+
+    // New days show up on top. Children refer to their day by group, not by
+    // row, so existing indexes stay valid
+    if (newGroupCount > oldGroupCount) {
+        beginInsertRows(QModelIndex(), 0, newGroupCount - oldGroupCount - 1);
+        m_fetchedCounts.resize(newGroupCount);
+        for (int group = oldGroupCount; group < newGroupCount; ++group) {
+            m_eventCounts.append(m_table.dateGroups().at(group).eventCount);
+        }
+        endInsertRows();
+    }
+
+    if (addedToLast > 0) {
+        // Mapping rows to groups is its own inverse
+        const QModelIndex lastIndex = index(groupForRow(lastGroup), 0);
+        // Fetched children are the newest ones, so the new events go on top
+        if (m_fetchedCounts.at(lastGroup) > 0) {
+            beginInsertRows(lastIndex, 0, addedToLast - 1);
+            m_eventCounts[lastGroup] += addedToLast;
+            m_fetchedCounts[lastGroup] += addedToLast;
+            endInsertRows();
+        } else {
+            m_eventCounts[lastGroup] += addedToLast;
+        }
+        // Let proxies check again whether the day should be shown
+        Q_EMIT dataChanged(lastIndex, lastIndex.sibling(lastIndex.row(), ColumnCount - 1));
+    }
+}
+
+const HistoryTable &HistoryModel::table() const
+{
+    return m_table;
+}
+
+int HistoryModel::groupForRow(int row) const
+{
+    // Groups are stored oldest first, but shown newest first
+    return m_eventCounts.size() - 1 - row;
+}
+
+int HistoryModel::eventForRow(int group, int row) const
+{
+    const HistoryDateGroup &dateGroup = m_table.dateGroups().at(group);
+    return dateGroup.firstEvent + m_eventCounts.at(group) - 1 - row;
+}
+
+int HistoryModel::eventAt(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0) {
+        return -1;
+    }
+
+    return eventForRow(int(index.internalId()) - 1, index.row());
+}
+
+QModelIndex HistoryModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid()) {
+        return createIndex(row, column, quintptr(0));
+    }
+
+    // Children carry their group (offset by one, 0 marks top-level rows)
+    return createIndex(row, column, quintptr(groupForRow(parent.row()) + 1));
+}
+
+QModelIndex HistoryModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || child.internalId() == 0) {
+        return QModelIndex();
+    }
+
+    const int group = int(child.internalId()) - 1;
+    return createIndex(groupForRow(group), 0, quintptr(0));
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return m_eventCounts.size();
+    }
+
+    if (parent.internalId() != 0 || parent.column() != 0) {
+        return 0;
+    }
+
+    return m_fetchedCounts.at(groupForRow(parent.row()));
+}
+
+int HistoryModel::columnCount(const QModelIndex & /*parent*/) const
+{
+    return ColumnCount;
+}
+
+bool HistoryModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return !m_eventCounts.isEmpty();
+    }
+
+    // Every date group has at least one event, fetched or not
+    return parent.internalId() == 0 && parent.column() == 0;
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid() || parent.internalId() != 0) {
+        return false;
+    }
+
+    const int group = groupForRow(parent.row());
+    return m_fetchedCounts.at(group) < m_eventCounts.at(group);
+}
+
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    const int group = groupForRow(parent.row());
+    const int fetched = m_fetchedCounts.at(group);
+    const int toFetch = qMin(fetchBatchSize, m_eventCounts.at(group) - fetched);
+
+    beginInsertRows(parent.sibling(parent.row(), 0), fetched, fetched + toFetch - 1);
+    m_fetchedCounts[group] += toFetch;
+    endInsertRows();
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (index.internalId() == 0) {
+        const int group = groupForRow(index.row());
+        const HistoryDateGroup &dateGroup = m_table.dateGroups().at(group);
+        switch (role) {
+        case Qt::DisplayRole:
+            if (index.column() == PackageColumn) {
+                return QLocale().toString(dateGroup.date, QLocale::ShortFormat);
+            }
+            break;
+        case HistoryDateRole:
+            return QDateTime::fromMSecsSinceEpoch(m_table.events().at(dateGroup.firstEvent + m_eventCounts.at(group) - 1).time);
+        }
+        return QVariant();
+    }
+
+    const HistoryEvent &event = m_table.events().at(eventAt(index));
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case PackageColumn:
+            return m_table.packageName(event.package);
+        case ActionColumn:
+            return actionName(event.action);
+        case TimeColumn:
+            return QLocale().toString(QDateTime::fromMSecsSinceEpoch(event.time), QLocale::LongFormat);
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == PackageColumn) {
+            return actionIcon(event.action);
+        }
+        break;
+    case HistoryDateRole:
+        return QDateTime::fromMSecsSinceEpoch(event.time);
+    case HistoryActionRole:
+        return event.action;
+    }
+
+    return QVariant();
+}
+
+QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case PackageColumn:
+        return i18nc("@title:column", "Package");
+    case ActionColumn:
+        return i18nc("@title:column", "Action");
+    case TimeColumn:
+        return i18nc("@title:column", "Time");
+    }
+
+    return QVariant();
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef HISTORYMODEL_H
+#define HISTORYMODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+
+#include "HistoryTable.h"
+
+/**
+ * Two-level model over a HistoryTable: one top-level row per day, with the
+ * package events of that day as children. Newest entries come first.
+ *
+ * Children are materialized lazily through fetchMore() when a day is expanded,
+ * and nothing but the table itself is stored per event.
+ */
+class HistoryModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum {
+        HistoryDateRole = Qt::UserRole + 1,
+        HistoryActionRole = Qt::UserRole + 2
+    };
+    enum Columns {
+        PackageColumn = 0,
+        ActionColumn,
+        TimeColumn,
+        ColumnCount
+    };
+
+    explicit HistoryModel(QObject *parent = nullptr);
+
+    static QString actionName(int action);
+    static QIcon actionIcon(int action);
+
+    void setTable(const HistoryTable &table);
+    /** Takes over @p table, which must be the current table with events appended */
+    void appendFromTable(const HistoryTable &table);
+    const HistoryTable &table() const;
+
+    /** @returns the index into HistoryTable::dateGroups() of the given top-level @p row */
+    int groupForRow(int row) const;
+    /** @returns the index into HistoryTable::events() for @p index, or -1 for date rows */
+    int eventAt(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    HistoryTable m_table;
+    // Number of child rows already exposed per date group
+    QVector<int> m_fetchedCounts;
+    // Number of events per date group as announced to views, which may lag
+    // behind m_table while appended events are being inserted
+    QVector<int> m_eventCounts;
+
+    int eventForRow(int group, int row) const;
+};
+
+#endif
@@ -20,12 +20,13 @@
 
 #include "HistoryProxyModel.h"
 
-#include <QStandardItemModel>
-#include <QStandardItem>
+#include "HistoryModel.h"
 
 HistoryProxyModel::HistoryProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
     , m_stateFilter((QApt::Package::State)0)
+    , m_indexedEventCount(-1)
+    , m_filterIndexDirty(true)
 {
 }
 
@@ -36,52 +37,91 @@ HistoryProxyModel::~HistoryProxyModel()
 void HistoryProxyModel::search(const QString &searchText)
 {
     m_searchText = searchText;
+    m_filterIndexDirty = true;
     invalidate();
 }
 
 void HistoryProxyModel::setStateFilter(QApt::Package::State state)
 {
     m_stateFilter = state;
+    m_filterIndexDirty = true;
     invalidate();
 }
 
-bool HistoryProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+HistoryModel *HistoryProxyModel::historyModel() const
 {
-    QModelIndex sourceIndex = sourceModel()->index(sourceRow, 0, sourceParent);
-        for(int i = 0 ; i < sourceModel()->rowCount(sourceIndex); i++) {
-            if (filterAcceptsRow(i, sourceIndex)) {
-                return true;
-            }
-        }
+    return static_cast<HistoryModel *>(sourceModel());
+}
 
-    //Our "main"-method
-    QStandardItem *item = static_cast<QStandardItemModel *>(sourceModel())->itemFromIndex(sourceModel()->index(sourceRow, 0, sourceParent));
+bool HistoryProxyModel::isFiltering() const
+{
+    return m_stateFilter != 0 || !m_searchText.isEmpty();
+}
 
-    if (!item) {
-        return false;
+void HistoryProxyModel::updateFilterIndex() const
+{
+    const HistoryTable &table = historyModel()->table();
+
+    // The table only ever grows, so its size tells whether it changed under us
+    if (!m_filterIndexDirty && m_indexedEventCount == table.events().size()) {
+        return;
     }
 
-    if (!m_stateFilter == 0) {
-        if ((bool)(item->data(HistoryActionRole).toInt() & m_stateFilter) == false) {
-            return false;
+    m_acceptedPackages.fill(m_searchText.isEmpty(), table.packageCount());
+    if (!m_searchText.isEmpty()) {
+        for (int id : table.packagesMatching(m_searchText)) {
+            m_acceptedPackages.setBit(id);
         }
     }
 
-    if (!m_searchText.isEmpty()) {
-        if ((bool)(item->data(Qt::DisplayRole).toString().contains(m_searchText)) == false) {
-            return false;
+    m_acceptedGroups.fill(false, table.dateGroups().size());
+    for (int id = 0; id < table.packageCount(); ++id) {
+        if (!m_acceptedPackages.testBit(id)) {
+            continue;
+        }
+
+        for (int event : table.packageEvents(id)) {
+            if (eventAccepted(table.events().at(event))) {
+                m_acceptedGroups.setBit(table.groupOfEvent(event));
+            }
         }
     }
 
-    return true;
+    m_indexedEventCount = table.events().size();
+    m_filterIndexDirty = false;
 }
 
-bool HistoryProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+bool HistoryProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
-    QStandardItemModel *parentModel = static_cast<QStandardItemModel *>(sourceModel());
+    if (!isFiltering()) {
+        return true;
+    }
+
+    updateFilterIndex();
+
+    const HistoryModel *model = historyModel();
+
+    if (!sourceParent.isValid()) {
+        // Date rows are shown if any of their events are, including the ones
+        // that have not been fetched into the model yet
+        return m_acceptedGroups.testBit(model->groupForRow(sourceRow));
+    }
+
+    const int event = model->eventAt(model->index(sourceRow, 0, sourceParent));
+    if (event < 0) {
+        return false;
+    }
+
+    return eventAccepted(model->table().events().at(event));
+}
 
-    QStandardItem *leftItem = parentModel->itemFromIndex(left);
-    QStandardItem *rightItem = parentModel->itemFromIndex(right);
+bool HistoryProxyModel::eventAccepted(const HistoryEvent &event) const
+{
+    if (!m_stateFilter == 0) {
+        if ((bool)(event.action & m_stateFilter) == false) {
+            return false;
+        }
+    }
 
-    return (leftItem->data(HistoryDateRole).toDateTime() > rightItem->data(HistoryDateRole).toDateTime());
+    return m_acceptedPackages.testBit(event.package);
 }
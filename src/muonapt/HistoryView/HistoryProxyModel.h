@@ -22,17 +22,17 @@
 #define HISTORYPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QtCore/QBitArray>
 
 #include <QApt/Package>
 
+struct HistoryEvent;
+class HistoryModel;
+
 class HistoryProxyModel : public QSortFilterProxyModel
 {
     Q_OBJECT
 public:
-    enum {
-        HistoryDateRole = Qt::UserRole + 1,
-        HistoryActionRole = Qt::UserRole + 2
-    };
     HistoryProxyModel(QObject *parent);
     ~HistoryProxyModel();
 
@@ -41,12 +41,21 @@ public:
 
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
 
-protected:
-    bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
-
 private:
+    HistoryModel *historyModel() const;
+    bool isFiltering() const;
+    void updateFilterIndex() const;
+    bool eventAccepted(const HistoryEvent &event) const;
+
     QString m_searchText;
     QApt::Package::State m_stateFilter;
+
+    // Filter results, resolved once per filter change through the name index
+    // of the history table rather than once per row
+    mutable QBitArray m_acceptedPackages;
+    mutable QBitArray m_acceptedGroups;
+    mutable int m_indexedEventCount;
+    mutable bool m_filterIndexDirty;
 };
 
 #endif
@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryStore.h"
+
+#include <QtConcurrentRun>
+#include <QCoreApplication>
+#include <QFileSystemWatcher>
+#include <QPointer>
+
+HistoryStore::HistoryStore(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<HistoryTable>(this))
+    , m_logWatcher(new QFileSystemWatcher(this))
+    , m_loaded(false)
+{
+    connect(m_watcher, &QFutureWatcher<HistoryTable>::finished, this, &HistoryStore::tableLoaded);
+    connect(m_logWatcher, &QFileSystemWatcher::fileChanged, this, &HistoryStore::liveLogChanged);
+}
+
+HistoryStore *HistoryStore::self()
+{
+    static QPointer<HistoryStore> self;
+    if (!self) {
+        self = new HistoryStore(QCoreApplication::instance());
+    }
+    return self;
+}
+
+const HistoryTable &HistoryStore::table() const
+{
+    return m_table;
+}
+
+bool HistoryStore::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool HistoryStore::isLoading() const
+{
+    return m_watcher->isRunning();
+}
+
+void HistoryStore::load()
+{
+    if (isLoading()) {
+        return;
+    }
+
+    m_watcher->setFuture(QtConcurrent::run([this]() {
+        return m_reader.readAll();
+    }));
+}
+
+void HistoryStore::update()
+{
+    if (isLoading()) {
+        return;
+    }
+
+    if (!m_loaded) {
+        load();
+        return;
+    }
+
+    const int eventCount = m_table.events().size();
+    if (!m_reader.readTail(&m_table)) {
+        // The log has been rotated since we last looked
+        load();
+        return;
+    }
+
+    if (m_table.events().size() != eventCount) {
+        Q_EMIT appended();
+    }
+}
+
+void HistoryStore::tableLoaded()
+{
+    m_table = m_watcher->result();
+    m_loaded = true;
+
+    if (!m_logWatcher->files().contains(m_reader.livePath())) {
+        m_logWatcher->addPath(m_reader.livePath());
+    }
+
+    Q_EMIT loaded();
+}
+
+void HistoryStore::liveLogChanged()
+{
+    // Rotation replaces the file, which drops it from the watcher
+    if (!m_logWatcher->files().contains(m_reader.livePath())) {
+        m_logWatcher->addPath(m_reader.livePath());
+    }
+
+    update();
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include <QtCore/QObject>
+#include <QFutureWatcher>
+
+#include "HistoryLogReader.h"
+#include "HistoryTable.h"
+
+class QFileSystemWatcher;
+
+/**
+ * Application-wide owner of the parsed apt history, shared by the history
+ * dialog and the package details view so the log is only parsed once.
+ *
+ * Once loaded, the live log is watched and new transactions are appended to
+ * the table as apt finishes them.
+ */
+class HistoryStore : public QObject
+{
+    Q_OBJECT
+public:
+    static HistoryStore *self();
+
+    const HistoryTable &table() const;
+    bool isLoaded() const;
+    bool isLoading() const;
+
+public Q_SLOTS:
+    /** Parses all history logs in the background, unless a parse is already running */
+    void load();
+    /** Appends what was logged since the last read, or loads everything if needed */
+    void update();
+
+Q_SIGNALS:
+    /** The table has been replaced as a whole */
+    void loaded();
+    /** Events have been appended to the end of the table */
+    void appended();
+
+private Q_SLOTS:
+    void tableLoaded();
+    void liveLogChanged();
+
+private:
+    explicit HistoryStore(QObject *parent);
+
+    HistoryTable m_table;
+    // Only used by the worker while loading, and by the GUI thread otherwise
+    HistoryLogReader m_reader;
+    QFutureWatcher<HistoryTable> *m_watcher;
+    QFileSystemWatcher *m_logWatcher;
+    bool m_loaded;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "HistoryTable.h"
+
+#include <algorithm>
+
+#include <QtCore/QSet>
+
+static quint64 trigramKey(const QChar *chars)
+{
+    return (quint64(chars[0].unicode()) << 32) | (quint64(chars[1].unicode()) << 16) | chars[2].unicode();
+}
+
+HistoryTable::HistoryTable()
+{
+}
+
+void HistoryTable::appendTransaction(const QDateTime &startDate, int action, const QStringList &packages)
+{
+    if (packages.isEmpty()) {
+        return;
+    }
+
+    const QDate date = startDate.date();
+    if (m_dateGroups.isEmpty() || m_dateGroups.constLast().date != date) {
+        m_dateGroups.append({date, int(m_events.size()), 0});
+    }
+
+    const qint64 time = startDate.toMSecsSinceEpoch();
+    for (const QString &package : packages) {
+        const int id = internPackage(package);
+        m_packageEvents[id].append(int(m_events.size()));
+        m_events.append({time, id, action});
+    }
+    m_dateGroups.last().eventCount += packages.size();
+}
+
+void HistoryTable::squeeze()
+{
+    m_events.squeeze();
+    m_dateGroups.squeeze();
+}
+
+int HistoryTable::internPackage(const QString &name)
+{
+    auto it = m_packageIds.constFind(name);
+    if (it != m_packageIds.constEnd()) {
+        return it.value();
+    }
+
+    const int id = m_packageNames.size();
+    m_packageNames.append(name);
+    m_packageIds.insert(name, id);
+    m_packageEvents.append(QVector<int>());
+
+    const QString lowerName = name.toLower();
+    m_lowerNames.append(lowerName);
+
+    QSet<quint64> seen;
+    for (int i = 0; i + 3 <= lowerName.size(); ++i) {
+        const quint64 key = trigramKey(lowerName.constData() + i);
+        if (!seen.contains(key)) {
+            seen.insert(key);
+            m_trigrams[key].append(id);
+        }
+    }
+
+    return id;
+}
+
+int HistoryTable::packageId(const QString &name) const
+{
+    return m_packageIds.value(name, -1);
+}
+
+QVector<int> HistoryTable::packagesMatching(const QString &text) const
+{
+    const QString needle = text.toLower();
+    QVector<int> result;
+
+    if (needle.size() < 3) {
+        // Too short for the trigram index. There are only as many names as
+        // distinct packages in the history, so a plain scan is cheap enough
+        for (int id = 0; id < m_lowerNames.size(); ++id) {
+            if (m_lowerNames.at(id).contains(needle)) {
+                result.append(id);
+            }
+        }
+        return result;
+    }
+
+    // Every trigram of the needle must be in the name, so the rarest one
+    // gives the shortest list of candidates to verify
+    const QVector<int> *candidates = nullptr;
+    for (int i = 0; i + 3 <= needle.size(); ++i) {
+        auto it = m_trigrams.constFind(trigramKey(needle.constData() + i));
+        if (it == m_trigrams.constEnd()) {
+            return result;
+        }
+        if (!candidates || it->size() < candidates->size()) {
+            candidates = &it.value();
+        }
+    }
+
+    for (int id : *candidates) {
+        if (m_lowerNames.at(id).contains(needle)) {
+            result.append(id);
+        }
+    }
+
+    return result;
+}
+
+const QVector<int> &HistoryTable::packageEvents(int id) const
+{
+    return m_packageEvents.at(id);
+}
+
+QString HistoryTable::packageName(int id) const
+{
+    return m_packageNames.at(id);
+}
+
+int HistoryTable::packageCount() const
+{
+    return m_packageNames.size();
+}
+
+const QVector<HistoryEvent> &HistoryTable::events() const
+{
+    return m_events;
+}
+
+const QVector<HistoryDateGroup> &HistoryTable::dateGroups() const
+{
+    return m_dateGroups;
+}
+
+int HistoryTable::groupOfEvent(int event) const
+{
+    auto it = std::upper_bound(m_dateGroups.cbegin(), m_dateGroups.cend(), event,
+                               [](int e, const HistoryDateGroup &group) {
+        return e < group.firstEvent;
+    });
+    return int(it - m_dateGroups.cbegin()) - 1;
+}
+
+bool HistoryTable::isEmpty() const
+{
+    return m_events.isEmpty();
+}
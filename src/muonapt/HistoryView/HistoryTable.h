@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef HISTORYTABLE_H
+#define HISTORYTABLE_H
+
+#include <QtCore/QDate>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+/**
+ * A single package event of the apt history. Package names are interned in the
+ * owning HistoryTable, so an event is three plain integers.
+ */
+struct HistoryEvent
+{
+    qint64 time;  // Start of the transaction, in msecs since the epoch
+    int package;  // Interned package id, see HistoryTable::packageName()
+    int action;   // The past action as a QApt::Package::State flag
+};
+
+/**
+ * A contiguous range of events that took place on the same day.
+ */
+struct HistoryDateGroup
+{
+    QDate date;
+    int firstEvent;
+    int eventCount;
+};
+
+/**
+ * Compact, chronologically ordered table of apt history events.
+ *
+ * Events are only ever appended, so existing event and date group indexes stay
+ * valid when newer transactions are added.
+ *
+ * The table also keeps a package name index: the events of every package, and
+ * a trigram index over the lowercased package names for substring searches.
+ */
+class HistoryTable
+{
+public:
+    HistoryTable();
+
+    void appendTransaction(const QDateTime &startDate, int action, const QStringList &packages);
+    /** Releases the spare capacity left over from appending */
+    void squeeze();
+
+    int internPackage(const QString &name);
+    QString packageName(int id) const;
+    int packageCount() const;
+    /** @returns the interned id of @p name, or -1 if it never appears in the history */
+    int packageId(const QString &name) const;
+
+    /** @returns the ids of all packages whose name contains @p text, ignoring case */
+    QVector<int> packagesMatching(const QString &text) const;
+    /** @returns the indexes of all events of package @p id, oldest first */
+    const QVector<int> &packageEvents(int id) const;
+
+    const QVector<HistoryEvent> &events() const;
+    const QVector<HistoryDateGroup> &dateGroups() const;
+    int groupOfEvent(int event) const;
+    bool isEmpty() const;
+
+private:
+    QVector<HistoryEvent> m_events;
+    QVector<HistoryDateGroup> m_dateGroups;
+    QStringList m_packageNames;
+    QHash<QString, int> m_packageIds;
+
+    // Name index
+    QStringList m_lowerNames;
+    QVector<QVector<int>> m_packageEvents;
+    QHash<quint64, QVector<int>> m_trigrams;
+};
+
+#endif
@@ -22,31 +22,29 @@
 
 #include <QtCore/QTimer>
 #include <QtWidgets/QLabel>
-#include <QListView>
 #include <QtWidgets/QTreeView>
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QLineEdit>
 #include <QtWidgets/QComboBox>
-#include <QStandardItemModel>
 #include <QEvent>
 #include <QHeaderView>
 
 #include <QApplication>
 #include <KLocalizedString>
 
-#include <QApt/History>
-
+#include "HistoryDelegate.h"
+#include "HistoryModel.h"
 #include "HistoryProxyModel.h"
+#include "HistoryStore.h"
+#include "Widgets/BusyIndicator.h"
 
 const QString itemStyleSheet = QStringLiteral("QTreeView::item { padding-left: 10px; padding-right: 10px; }");
 
 HistoryView::HistoryView(QWidget *parent)
-    : QWidget(parent),
-      m_colorScheme(QPalette::Current, KColorScheme::Window)
+    : QWidget(parent)
 {
     QLayout *viewLayout = new QVBoxLayout(this);
     setLayout(viewLayout);
-    m_history = new QApt::History(this);
 
     QWidget *headerWidget = new QWidget(this);
     QHBoxLayout *headerLayout = new QHBoxLayout(headerWidget);
@@ -71,7 +69,6 @@ HistoryView::HistoryView(QWidget *parent)
     QIcon upgradeIcon = QIcon::fromTheme(QStringLiteral("system-software-update"));
     QIcon removeIcon = QIcon::fromTheme(QStringLiteral("edit-delete"));
     QIcon downgradeIcon = QIcon::fromTheme(QStringLiteral("go-down"));
-    QIcon purgeIcon = QIcon::fromTheme(QStringLiteral("edit-delete-shred"));
     QIcon reinstallIcon = QIcon::fromTheme(QStringLiteral("view-refresh"));
 
     m_filterBox = new QComboBox(headerWidget);
@@ -108,116 +105,50 @@ HistoryView::HistoryView(QWidget *parent)
 
     viewLayout->addWidget(headerWidget);
 
-    m_historyModel = new QStandardItemModel(this);
-    m_historyModel->setColumnCount(3);
-    m_historyModel->setHeaderData(0, Qt::Horizontal, i18nc("@title:column", "Package"));
-    m_historyModel->setHeaderData(1, Qt::Horizontal, i18nc("@title:column", "Action"));
-    m_historyModel->setHeaderData(2, Qt::Horizontal, i18nc("@title:column", "Time"));
+    m_historyModel = new HistoryModel(this);
+    m_delegate = new HistoryDelegate(this);
 
     m_historyView = new QTreeView(this);
     m_historyView->setRootIsDecorated(true);
     m_historyView->setAlternatingRowColors(true);
     m_historyView->setMouseTracking(true);
+    m_historyView->setUniformRowHeights(true);
     m_historyView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
     m_historyView->setStyleSheet(itemStyleSheet);
+    m_historyView->setItemDelegate(m_delegate);
     m_historyView->header()->setStretchLastSection(false);
 
-    QHash<QString, QString> categoryHash;
-
-    QHash<QApt::Package::State, QString> actionHash;
-    actionHash[QApt::Package::ToInstall] = i18nc("@info:status describes a past-tense action", "Installed");
-    actionHash[QApt::Package::ToUpgrade] = i18nc("@info:status describes a past-tense action", "Upgraded");
-    actionHash[QApt::Package::ToDowngrade] = i18nc("@status describes a past-tense action", "Downgraded");
-    actionHash[QApt::Package::ToRemove] = i18nc("@status describes a past-tense action", "Removed");
-    actionHash[QApt::Package::ToPurge] = i18nc("@status describes a past-tense action", "Purged");
-    actionHash[QApt::Package::ToReInstall] = i18nc("@status describes a past-tense action", "Reinstalled");
-
-    for (const QApt::HistoryItem &item: m_history->historyItems()) {
-        QLocale locale;
-        QDateTime startDateTime = item.startDate();
-        QString formattedTime = locale.toString(startDateTime, QLocale::LongFormat);
-        QString category;
-
-        QString date = startDateTime.date().toString();
-        if (categoryHash.contains(date)) {
-            category = categoryHash.value(date);
-        } else {
-            category = locale.toString(startDateTime.date(), QLocale::ShortFormat);
-            categoryHash[date] = category;
-        }
-
-        QStandardItem *parentItem = nullptr;
-        if (!m_dateCategoryItems.contains(category)) {
-            QList<QStandardItem*> parentRow;
-            QStandardItem *dateItem = new QStandardItem(category);
-            dateItem->setEditable(false);
-            dateItem->setData(startDateTime, HistoryProxyModel::HistoryDateRole);
-            parentRow << dateItem;
-            m_historyModel->appendRow(parentRow);
-            m_dateCategoryItems[category] = dateItem;
-            parentItem = dateItem;
-        } else {
-            parentItem = m_dateCategoryItems.value(category);
-        }
-
-        auto addChildRow = [&](const QString &pkg, QApt::Package::State pastAction, const QIcon &icon) {
-            QList<QStandardItem*> childRow;
-            QStandardItem *pkgItem = new QStandardItem(icon, pkg);
-            pkgItem->setEditable(false);
-            pkgItem->setData(startDateTime, HistoryProxyModel::HistoryDateRole);
-            pkgItem->setData(pastAction, HistoryProxyModel::HistoryActionRole);
-
-            QStandardItem *actionItem = new QStandardItem(actionHash.value(pastAction));
-            actionItem->setEditable(false);
-            actionItem->setData(startDateTime, HistoryProxyModel::HistoryDateRole);
-            actionItem->setData(pastAction, HistoryProxyModel::HistoryActionRole);
-
-            QStandardItem *timeItem = new QStandardItem(formattedTime);
-            timeItem->setEditable(false);
-            timeItem->setData(startDateTime, HistoryProxyModel::HistoryDateRole);
-            timeItem->setData(pastAction, HistoryProxyModel::HistoryActionRole);
-
-            updateItemColors(pkgItem, m_colorScheme);
-            updateItemColors(actionItem, m_colorScheme);
-            updateItemColors(timeItem, m_colorScheme);
-
-            childRow << pkgItem << actionItem << timeItem;
-            parentItem->appendRow(childRow);
-        };
-
-        for (const QString &package: item.installedPackages()) {
-            addChildRow(package, QApt::Package::ToInstall, installIcon);
-        }
-        for (const QString &package: item.upgradedPackages()) {
-            addChildRow(package, QApt::Package::ToUpgrade, upgradeIcon);
-        }
-        for (const QString &package: item.downgradedPackages()) {
-            addChildRow(package, QApt::Package::ToDowngrade, downgradeIcon);
-        }
-        for (const QString &package: item.removedPackages()) {
-            addChildRow(package, QApt::Package::ToRemove, removeIcon);
-        }
-        for (const QString &package: item.purgedPackages()) {
-            addChildRow(package, QApt::Package::ToPurge, purgeIcon);
-        }
-        for (const QString &package: item.reinstalledPackages()) {
-            addChildRow(package, QApt::Package::ToReInstall, reinstallIcon);
-        }
-    }
-
     viewLayout->addWidget(m_historyView);
 
     m_proxyModel = new HistoryProxyModel(this);
     m_proxyModel->setSourceModel(m_historyModel);
-    m_proxyModel->sort(0);
 
     m_historyView->setModel(m_proxyModel);
 
     connect(m_proxyModel, &QAbstractItemModel::layoutChanged, this, &HistoryView::updateSpanning);
     connect(m_proxyModel, &QAbstractItemModel::modelReset, this, &HistoryView::updateSpanning);
+    connect(m_proxyModel, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent) {
+        if (!parent.isValid()) {
+            updateSpanning();
+        }
+    });
 
     updateSpanning();
 
+    m_busyWidget = new BusyIndicator(m_historyView->viewport());
+
+    // Parsing years of history can take a while, keep the dialog responsive.
+    // If it has been parsed before, only the tail of the log needs reading
+    HistoryStore *store = HistoryStore::self();
+    connect(store, &HistoryStore::loaded, this, &HistoryView::historyLoaded);
+    connect(store, &HistoryStore::appended, this, &HistoryView::historyAppended);
+    if (store->isLoaded()) {
+        m_historyModel->setTable(store->table());
+    } else {
+        m_busyWidget->start();
+    }
+    store->update();
+
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
 }
 
@@ -237,43 +168,15 @@ void HistoryView::startSearch()
     m_proxyModel->search(m_searchEdit->text());
 }
 
-void HistoryView::updateItemColors(QStandardItem *item, const KColorScheme &scheme)
+void HistoryView::historyLoaded()
 {
-    if (item->data(HistoryProxyModel::HistoryActionRole).isValid()) {
-        int action = item->data(HistoryProxyModel::HistoryActionRole).toInt();
-        QColor color;
-        switch (action) {
-            case QApt::Package::ToInstall:
-                color = scheme.foreground(KColorScheme::PositiveText).color();
-                break;
-            case QApt::Package::ToUpgrade:
-                color = scheme.decoration(KColorScheme::FocusColor).color();
-                break;
-            case QApt::Package::ToDowngrade:
-                color = scheme.foreground(KColorScheme::NeutralText).color();
-                break;
-            case QApt::Package::ToRemove:
-            case QApt::Package::ToPurge:
-                color = scheme.foreground(KColorScheme::NegativeText).color();
-                break;
-            case QApt::Package::ToReInstall:
-                color = scheme.foreground(KColorScheme::VisitedText).color();
-                break;
-            default:
-                color = scheme.foreground(KColorScheme::NormalText).color();
-                break;
-        }
-        item->setData(color, Qt::ForegroundRole);
-    }
+    m_historyModel->setTable(HistoryStore::self()->table());
+    m_busyWidget->stop();
+}
 
-    for (int row = 0; row < item->rowCount(); ++row) {
-        int cols = item->columnCount();
-        for (int col = 0; col < cols; ++col) {
-            QStandardItem *child = item->child(row, col);
-            if (child)
-                updateItemColors(child, scheme);
-        }
-    }
+void HistoryView::historyAppended()
+{
+    m_historyModel->appendFromTable(HistoryStore::self()->table());
 }
 
 bool HistoryView::event(QEvent *event)
@@ -288,25 +191,18 @@ void HistoryView::updateAllItemColors()
 {
     m_historyView->setStyleSheet(itemStyleSheet);
 
-    m_colorScheme = KColorScheme(QPalette::Current, KColorScheme::Window);
-    for (int i = 0; i < m_historyModel->rowCount(); ++i) {
-        QStandardItem *item = m_historyModel->item(i);
-        updateItemColors(item, m_colorScheme);
-    }
+    m_delegate->updateColorScheme();
+    m_historyView->viewport()->update();
 }
 
 void HistoryView::updateSpanning()
 {
-    for (int row = 0; row < m_historyModel->rowCount(); ++row) {
-        QStandardItem *parentItem = m_historyModel->item(row);
-
-        if (parentItem && parentItem->hasChildren()) {
-            m_historyView->setFirstColumnSpanned(row, QModelIndex(), true);
-        }
+    for (int row = 0; row < m_proxyModel->rowCount(); ++row) {
+        m_historyView->setFirstColumnSpanned(row, QModelIndex(), true);
     }
 
     m_historyView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
-    for (int col = 1; col < m_historyModel->columnCount(); ++col) {
+    for (int col = 1; col < m_proxyModel->columnCount(); ++col) {
         m_historyView->header()->setSectionResizeMode(col, QHeaderView::ResizeToContents);
     }
 }
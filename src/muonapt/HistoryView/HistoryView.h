@@ -21,23 +21,16 @@
 #ifndef HISTORYVIEW_H
 #define HISTORYVIEW_H
 
-#include <QtCore/QHash>
-
 #include <QWidget>
 
-#include <KColorScheme>
-
-class QStandardItem;
-class QStandardItemModel;
 class QTimer;
 class QTreeView;
 class QLineEdit;
 class QComboBox;
 
-namespace QApt {
-    class History;
-}
-
+class BusyIndicator;
+class HistoryDelegate;
+class HistoryModel;
 class HistoryProxyModel;
 
 class HistoryView : public QWidget
@@ -57,19 +50,16 @@ public:
     QSize sizeHint() const override;
 
 private:
-    QApt::History *m_history;
-    QStandardItemModel *m_historyModel;
+    HistoryModel *m_historyModel;
     HistoryProxyModel *m_proxyModel;
-    QHash<QString, QStandardItem *> m_dateCategoryItems;
+    HistoryDelegate *m_delegate;
+    BusyIndicator *m_busyWidget;
 
     QLineEdit *m_searchEdit;
     QTimer *m_searchTimer;
     QComboBox *m_filterBox;
     QTreeView *m_historyView;
 
-    KColorScheme m_colorScheme;
-
-    void updateItemColors(QStandardItem *item, const KColorScheme &scheme);
     void updateAllItemColors();
 
 protected:
@@ -79,6 +69,8 @@ private Q_SLOTS:
     void setStateFilter(int index);
     void startSearch();
     void updateSpanning();
+    void historyLoaded();
+    void historyAppended();
 };
 
 #endif